@@ -0,0 +1,324 @@
+#include "archive.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Sudoku
+{
+    static const char ARCHIVE_MAGIC[4] = { 'S', 'U', 'D', 'K' };
+
+    std::array<uint32_t, 256> computeCrcTable()
+    {
+        std::array<uint32_t, 256> result;
+
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t value = i;
+            for (size_t bit = 0; bit < 8; ++bit)
+                value = (value & 1) ? (value >> 1) ^ 0xedb88320 : value >> 1;
+            result[i] = value;
+        }
+
+        return result;
+    }
+
+    uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size)
+    {
+        static const std::array<uint32_t, 256> table = computeCrcTable();
+
+        crc = ~crc;
+        for (size_t i = 0; i < size; ++i)
+            crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+
+        return ~crc;
+    }
+
+    // little endian numbers regardless of the platform
+    void writeLittleEndian(uint8_t* data, uint64_t value, size_t bytes)
+    {
+        for (size_t i = 0; i < bytes; ++i)
+            data[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+
+    uint64_t readLittleEndian(const uint8_t* data, size_t bytes)
+    {
+        uint64_t result = 0;
+        for (size_t i = 0; i < bytes; ++i)
+            result |= uint64_t(data[i]) << (8 * i);
+
+        return result;
+    }
+
+    size_t getIndexOffset(size_t count)
+    {
+        return (ARCHIVE_HEADER_SIZE + count * ARCHIVE_RECORD_SIZE + 7) / 8 * 8;
+    }
+
+    ArchiveWriter::~ArchiveWriter()
+    {
+        if (file.is_open())
+            close();
+    }
+
+    bool ArchiveWriter::open(const std::string& path)
+    {
+        file.open(path, std::ios::binary | std::ios::trunc);
+        index.clear();
+        crc = 0;
+
+        // header is written again by close, when the counts are known
+        std::array<uint8_t, ARCHIVE_HEADER_SIZE> header{};
+        file.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+        return file.good();
+    }
+
+    bool ArchiveWriter::add(const Board& board, const Board& solution, size_t difficulty)
+    {
+        std::array<uint8_t, ARCHIVE_RECORD_SIZE> record{};
+
+        writeLittleEndian(record.data(), std::min<size_t>(difficulty, std::numeric_limits<uint16_t>::max()), 2);
+
+        uint8_t* clues = record.data() + 2;
+        uint8_t* numbers = clues + ARCHIVE_CLUES_SIZE;
+        for (size_t cell = 0; cell < BOARD_SIZE * BOARD_SIZE; ++cell)
+        {
+            size_t row = cell / BOARD_SIZE, col = cell % BOARD_SIZE;
+
+            if (board[row][col] != 0)
+                clues[cell / 8] |= static_cast<uint8_t>(1 << (cell % 8));
+            numbers[cell / 2] |= static_cast<uint8_t>(solution[row][col] << (4 * (cell % 2)));
+        }
+
+        index.emplace_back(static_cast<uint32_t>(readLittleEndian(record.data(), 2)), static_cast<uint32_t>(index.size()));
+        crc = crc32(crc, record.data(), record.size());
+        file.write(reinterpret_cast<const char*>(record.data()), record.size());
+
+        return file.good();
+    }
+
+    bool ArchiveWriter::close()
+    {
+        size_t count = index.size();
+        size_t indexOffset = getIndexOffset(count);
+
+        std::array<uint8_t, 8> padding{};
+        size_t paddingSize = indexOffset - (ARCHIVE_HEADER_SIZE + count * ARCHIVE_RECORD_SIZE);
+        crc = crc32(crc, padding.data(), paddingSize);
+        file.write(reinterpret_cast<const char*>(padding.data()), paddingSize);
+
+        // records of the same difficulty stay in the order in which they were written
+        std::stable_sort(index.begin(), index.end(), [](const auto& l, const auto& r) { return l.first < r.first; });
+        for (auto [difficulty, record] : index)
+        {
+            std::array<uint8_t, ARCHIVE_INDEX_ENTRY_SIZE> entry;
+            writeLittleEndian(entry.data(), difficulty, 4);
+            writeLittleEndian(entry.data() + 4, record, 4);
+            crc = crc32(crc, entry.data(), entry.size());
+            file.write(reinterpret_cast<const char*>(entry.data()), entry.size());
+        }
+
+        std::array<uint8_t, ARCHIVE_HEADER_SIZE> header{};
+        std::memcpy(header.data(), ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+        writeLittleEndian(header.data() + 4, ARCHIVE_VERSION, 2);
+        writeLittleEndian(header.data() + 6, BOARD_SIZE, 1);
+        writeLittleEndian(header.data() + 8, count, 8);
+        writeLittleEndian(header.data() + 16, indexOffset, 8);
+        writeLittleEndian(header.data() + 24, crc, 4);
+
+        file.seekp(0);
+        file.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+        bool result = file.good();
+        file.close();
+        index.clear();
+
+        return result;
+    }
+
+    size_t ArchiveRecordView::getDifficulty() const
+    {
+        return readLittleEndian(data, 2);
+    }
+
+    bool ArchiveRecordView::isClue(size_t row, size_t col) const
+    {
+        size_t cell = row * BOARD_SIZE + col;
+        return (data[2 + cell / 8] >> (cell % 8)) & 1;
+    }
+
+    uint8_t ArchiveRecordView::getSolutionNumber(size_t row, size_t col) const
+    {
+        size_t cell = row * BOARD_SIZE + col;
+        return (data[2 + ARCHIVE_CLUES_SIZE + cell / 2] >> (4 * (cell % 2))) & 0xf;
+    }
+
+    uint8_t ArchiveRecordView::getNumber(size_t row, size_t col) const
+    {
+        return isClue(row, col) ? getSolutionNumber(row, col) : 0;
+    }
+
+    Board ArchiveRecordView::getBoard() const
+    {
+        Board result;
+        for (size_t r = 0; r < BOARD_SIZE; ++r)
+            for (size_t c = 0; c < BOARD_SIZE; ++c)
+                result[r][c] = getNumber(r, c);
+
+        return result;
+    }
+
+    Board ArchiveRecordView::getSolution() const
+    {
+        Board result;
+        for (size_t r = 0; r < BOARD_SIZE; ++r)
+            for (size_t c = 0; c < BOARD_SIZE; ++c)
+                result[r][c] = getSolutionNumber(r, c);
+
+        return result;
+    }
+
+    ArchiveReader::~ArchiveReader()
+    {
+        close();
+    }
+
+    bool ArchiveReader::open(const std::string& path, bool verify)
+    {
+        close();
+
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            file = nullptr;
+            return false;
+        }
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || size.QuadPart < LONGLONG(ARCHIVE_HEADER_SIZE))
+        {
+            close();
+            return false;
+        }
+        fileSize = static_cast<size_t>(size.QuadPart);
+
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping)
+            data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!data)
+        {
+            close();
+            return false;
+        }
+#else
+        int descriptor = ::open(path.c_str(), O_RDONLY);
+        if (descriptor < 0)
+            return false;
+
+        struct stat status;
+        if (fstat(descriptor, &status) != 0 || size_t(status.st_size) < ARCHIVE_HEADER_SIZE)
+        {
+            ::close(descriptor);
+            return false;
+        }
+        fileSize = static_cast<size_t>(status.st_size);
+
+        // mapping stays valid after the descriptor is closed
+        void* mapped = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        ::close(descriptor);
+        if (mapped == MAP_FAILED)
+        {
+            fileSize = 0;
+            return false;
+        }
+        data = static_cast<const uint8_t*>(mapped);
+#endif
+
+        count = readLittleEndian(data + 8, 8);
+        indexOffset = readLittleEndian(data + 16, 8);
+
+        bool valid = std::memcmp(data, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) == 0
+            && readLittleEndian(data + 4, 2) == ARCHIVE_VERSION
+            && readLittleEndian(data + 6, 1) == BOARD_SIZE
+            && count <= (fileSize - ARCHIVE_HEADER_SIZE) / (ARCHIVE_RECORD_SIZE + ARCHIVE_INDEX_ENTRY_SIZE)
+            && indexOffset == getIndexOffset(count)
+            && fileSize == indexOffset + count * ARCHIVE_INDEX_ENTRY_SIZE;
+
+        if (valid && verify)
+            valid = crc32(0, data + ARCHIVE_HEADER_SIZE, fileSize - ARCHIVE_HEADER_SIZE) == readLittleEndian(data + 24, 4);
+
+        // record numbers in the index are used without checks later
+        for (size_t i = 0; valid && i < count; ++i)
+            valid = readLittleEndian(data + indexOffset + i * ARCHIVE_INDEX_ENTRY_SIZE + 4, 4) < count;
+
+        if (!valid)
+            close();
+
+        return valid;
+    }
+
+    void ArchiveReader::close()
+    {
+#ifdef _WIN32
+        if (data)
+            UnmapViewOfFile(data);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file)
+            CloseHandle(file);
+        mapping = file = nullptr;
+#else
+        if (data)
+            munmap(const_cast<uint8_t*>(data), fileSize);
+#endif
+
+        data = nullptr;
+        fileSize = count = indexOffset = 0;
+    }
+
+    size_t ArchiveReader::size() const
+    {
+        return count;
+    }
+
+    ArchiveRecordView ArchiveReader::operator[](size_t record) const
+    {
+        return { data + ARCHIVE_HEADER_SIZE + record * ARCHIVE_RECORD_SIZE };
+    }
+
+    size_t ArchiveReader::lowerBound(size_t minDifficulty) const
+    {
+        size_t first = 0, last = count;
+        while (first < last)
+        {
+            size_t middle = first + (last - first) / 2;
+            if (getIndexDifficulty(middle) < minDifficulty)
+                first = middle + 1;
+            else
+                last = middle;
+        }
+
+        return first;
+    }
+
+    size_t ArchiveReader::getIndexDifficulty(size_t position) const
+    {
+        return readLittleEndian(data + indexOffset + position * ARCHIVE_INDEX_ENTRY_SIZE, 4);
+    }
+
+    ArchiveRecordView ArchiveReader::getIndexRecord(size_t position) const
+    {
+        return (*this)[readLittleEndian(data + indexOffset + position * ARCHIVE_INDEX_ENTRY_SIZE + 4, 4)];
+    }
+}
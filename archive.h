@@ -0,0 +1,104 @@
+#pragma once
+#include "sudoku.h"
+#include <string>
+#include <fstream>
+
+namespace Sudoku
+{
+    // binary archive of puzzle / solution pairs, all numbers are little endian
+    //   header (32 bytes): magic "SUDK", version (2 bytes), board size (1 byte), reserved (1 byte),
+    //       records count (8 bytes), index offset (8 bytes), crc32 of everything after the header (4 bytes),
+    //       reserved (4 bytes)
+    //   records (54 bytes each): difficulty (2 bytes), clues bitmap (11 bytes, bit i is cell i in row-major order),
+    //       solution (41 bytes, 4 bits per cell, low half of the byte first)
+    //   padding to 8 bytes
+    //   index (8 bytes per record): difficulty (4 bytes) and record number (4 bytes), sorted by difficulty
+    static const uint16_t ARCHIVE_VERSION = 1;
+    static const size_t ARCHIVE_HEADER_SIZE = 32;
+    static const size_t ARCHIVE_CLUES_SIZE = (BOARD_SIZE * BOARD_SIZE + 7) / 8;
+    static const size_t ARCHIVE_SOLUTION_SIZE = (BOARD_SIZE * BOARD_SIZE + 1) / 2;
+    static const size_t ARCHIVE_RECORD_SIZE = 2 + ARCHIVE_CLUES_SIZE + ARCHIVE_SOLUTION_SIZE;
+    static const size_t ARCHIVE_INDEX_ENTRY_SIZE = 8;
+
+    // crc32 (polynomial 0xedb88320) of data appended to data with checksum crc, 0 for no data
+    uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size);
+
+    // writes records as they come, index is written by close
+    struct ArchiveWriter
+    {
+        ArchiveWriter() {}
+        // closes the archive if it was not closed
+        ~ArchiveWriter();
+
+        ArchiveWriter(const ArchiveWriter&) = delete;
+        ArchiveWriter& operator=(const ArchiveWriter&) = delete;
+
+        bool open(const std::string& path);
+        // board must have only numbers of the solution
+        bool add(const Board& board, const Board& solution, size_t difficulty);
+        // writes the index and the header, returns false if some write failed
+        bool close();
+
+        std::ofstream file;
+        // difficulty and record number of each record
+        std::vector<std::pair<uint32_t, uint32_t>> index;
+        uint32_t crc = 0;
+    };
+
+    // record inside of the mapped archive, valid while the reader is open
+    struct ArchiveRecordView
+    {
+        const uint8_t* data = nullptr;
+
+        size_t getDifficulty() const;
+        bool isClue(size_t row, size_t col) const;
+        uint8_t getSolutionNumber(size_t row, size_t col) const;
+        // 0 for spaces
+        uint8_t getNumber(size_t row, size_t col) const;
+
+        // unpacked boards
+        Board getBoard() const;
+        Board getSolution() const;
+    };
+
+    // maps the archive to memory, records are decoded only when they are accessed
+    struct ArchiveReader
+    {
+        ArchiveReader() {}
+        ~ArchiveReader();
+
+        ArchiveReader(const ArchiveReader&) = delete;
+        ArchiveReader& operator=(const ArchiveReader&) = delete;
+
+        // returns false if the file can't be mapped or it is not a valid archive
+        // verify checks crc32, it reads the whole file
+        bool open(const std::string& path, bool verify = true);
+        void close();
+
+        size_t size() const;
+        // record in the order in which they were written
+        ArchiveRecordView operator[](size_t record) const;
+
+        // records in the order of difficulty, first position with difficulty at least minDifficulty
+        size_t lowerBound(size_t minDifficulty) const;
+        size_t getIndexDifficulty(size_t position) const;
+        ArchiveRecordView getIndexRecord(size_t position) const;
+
+        // calls function for records with difficulty in [minDifficulty, maxDifficulty) in the order of difficulty
+        template<class Function>
+        void forEachInDifficulty(size_t minDifficulty, size_t maxDifficulty, Function function) const
+        {
+            for (size_t i = lowerBound(minDifficulty); i < size() && getIndexDifficulty(i) < maxDifficulty; ++i)
+                function(getIndexRecord(i));
+        }
+
+        const uint8_t* data = nullptr;
+        size_t fileSize = 0;
+        size_t count = 0;
+        size_t indexOffset = 0;
+#ifdef _WIN32
+        void* file = nullptr;
+        void* mapping = nullptr;
+#endif
+    };
+}
@@ -0,0 +1,107 @@
+#include "batch.h"
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <chrono>
+#include <algorithm>
+
+namespace Sudoku
+{
+    // puzzle indices of one worker, owner takes from the front, thieves from the back
+    struct BatchQueue
+    {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+
+        std::optional<size_t> pop()
+        {
+            std::lock_guard lock(mutex);
+            if (tasks.empty())
+                return {};
+            size_t result = tasks.front();
+            tasks.pop_front();
+            return result;
+        }
+
+        std::optional<size_t> steal()
+        {
+            std::lock_guard lock(mutex);
+            if (tasks.empty())
+                return {};
+            size_t result = tasks.back();
+            tasks.pop_back();
+            return result;
+        }
+    };
+
+    BatchStats generateBatch(size_t count, size_t spaces, size_t minDifficulty, size_t maxDifficulty, size_t threads,
+        uint64_t seed, const BatchCallback& callback)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        if (threads == 0)
+            threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+        std::vector<BatchQueue> queues(threads);
+        for (size_t t = 0; t < threads; ++t)
+        {
+            for (size_t i = t * count / threads; i < (t + 1) * count / threads; ++i)
+                queues[t].tasks.push_back(i);
+        }
+
+        BatchStats stats;
+        stats.threads.resize(threads);
+        std::mutex callbackMutex;
+
+        auto worker = [&](size_t id)
+        {
+            auto start = Clock::now();
+            BatchThreadStats& threadStats = stats.threads[id];
+
+            while (true)
+            {
+                auto task = queues[id].pop();
+
+                // own queue is empty, try to take work from the others
+                // nothing is added to queues once started, so if all are empty we are done
+                for (size_t i = 1; !task && i < threads; ++i)
+                {
+                    task = queues[(id + i) % threads].steal();
+                    if (task)
+                        threadStats.stolen++;
+                }
+
+                if (!task)
+                    break;
+
+                BatchPuzzle puzzle;
+                puzzle.index = *task;
+                puzzle.seed = seed + *task;
+                puzzle.thread = id;
+
+                Generator generator(puzzle.seed);
+                std::tie(puzzle.board, puzzle.solution) = generateSudokuWithDifficulty(spaces, minDifficulty, maxDifficulty, generator);
+                puzzle.difficulty = computeDifficulty(puzzle.solution, puzzle.board);
+
+                threadStats.generated++;
+
+                std::lock_guard lock(callbackMutex);
+                callback(puzzle);
+            }
+
+            threadStats.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        };
+
+        auto start = Clock::now();
+
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; ++t)
+            workers.emplace_back(worker, t);
+        for (auto& w : workers)
+            w.join();
+
+        stats.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        return stats;
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "sudoku.h"
+#include <functional>
+
+namespace Sudoku
+{
+    struct BatchPuzzle
+    {
+        size_t index = 0;
+        // generateSudokuWithDifficulty with Generator(seed) gives the same puzzle again
+        uint64_t seed = 0;
+        Board board{};
+        Board solution{};
+        size_t difficulty = 0;
+        // worker which generated the puzzle
+        size_t thread = 0;
+    };
+
+    struct BatchThreadStats
+    {
+        size_t generated = 0;
+        // how many of generated puzzles were stolen from other workers
+        size_t stolen = 0;
+        double seconds = 0.0;
+    };
+
+    struct BatchStats
+    {
+        std::vector<BatchThreadStats> threads;
+        double seconds = 0.0;
+    };
+
+    // called in the order in which puzzles are finished, calls are serialized
+    using BatchCallback = std::function<void(const BatchPuzzle&)>;
+
+    // generates count puzzles with generateSudokuWithDifficulty on threads workers (0 means all cores)
+    // puzzles are split between workers up front, worker which runs out of work steals from others
+    // puzzle i is generated with seed + i, so the batch is reproducible regardless of scheduling
+    BatchStats generateBatch(size_t count, size_t spaces, size_t minDifficulty, size_t maxDifficulty, size_t threads,
+        uint64_t seed, const BatchCallback& callback);
+}
@@ -0,0 +1,231 @@
+#include "batchsolver.h"
+#include "candidates.h"
+#include <algorithm>
+
+#ifdef SUDOKU_SIMD_X86
+#ifdef _MSC_VER
+#define SUDOKU_TARGET_AVX2
+#else
+#define SUDOKU_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#include <immintrin.h>
+#endif
+
+namespace Sudoku
+{
+    // state of a board after the propagation
+    enum class Propagation
+    {
+        Invalid, // the board has no solution
+        Solved,
+        Open, // guessing is needed
+    };
+
+#ifdef SUDOKU_SIMD_X86
+    static const size_t BATCH_LANES = 16;
+
+    using Unit = std::array<uint8_t, BOARD_SIZE>;
+
+    // cells of each row, column and grid
+    std::array<Unit, 3 * BOARD_SIZE> computeUnits()
+    {
+        std::array<Unit, 3 * BOARD_SIZE> result;
+
+        for (size_t i = 0; i < BOARD_SIZE; ++i)
+        {
+            for (size_t j = 0; j < BOARD_SIZE; ++j)
+            {
+                size_t gridRow = i / GRID_COUNT * GRID_COUNT + j / GRID_COUNT, gridCol = i % GRID_COUNT * GRID_COUNT + j % GRID_COUNT;
+                result[i][j] = static_cast<uint8_t>(i * BOARD_SIZE + j);
+                result[BOARD_SIZE + i][j] = static_cast<uint8_t>(j * BOARD_SIZE + i);
+                result[2 * BOARD_SIZE + i][j] = static_cast<uint8_t>(gridRow * BOARD_SIZE + gridCol);
+            }
+        }
+
+        return result;
+    }
+
+    const std::array<Unit, 3 * BOARD_SIZE> g_units = computeUnits();
+
+    // all ones in lanes with a single candidate (and in lanes without any)
+    SUDOKU_TARGET_AVX2 inline __m256i singleLanes(__m256i candidates)
+    {
+        __m256i lowestCleared = _mm256_and_si256(candidates, _mm256_sub_epi16(candidates, _mm256_set1_epi16(1)));
+        return _mm256_cmpeq_epi16(lowestCleared, _mm256_setzero_si256());
+    }
+
+    // naked and hidden singles of 16 boards until nothing changes, unit by unit, so each unit already sees
+    // what the previous ones found, candidates only shrink, so it ends even for invalid boards
+    SUDOKU_TARGET_AVX2 void propagateAvx2(const Board* const* boards, Board* propagated, Propagation* results)
+    {
+        using G = Geometry9;
+
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i allCandidates = _mm256_set1_epi16(G::ALL_CANDIDATES);
+
+        // candidates of a cell in all boards, givens have single candidate
+        __m256i cells[G::CELLS_COUNT];
+        for (size_t cell = 0; cell < G::CELLS_COUNT; ++cell)
+        {
+            alignas(32) uint16_t lanes[BATCH_LANES];
+            for (size_t lane = 0; lane < BATCH_LANES; ++lane)
+            {
+                uint8_t number = (*boards[lane])[cell / BOARD_SIZE][cell % BOARD_SIZE];
+                lanes[lane] = number ? numberBit<uint16_t>(number) : G::ALL_CANDIDATES;
+            }
+            cells[cell] = _mm256_load_si256(reinterpret_cast<const __m256i*>(lanes));
+        }
+
+        // not zero in lanes of boards without solution
+        __m256i invalid = zero;
+
+        while (true)
+        {
+            __m256i changed = zero;
+
+            for (const auto& unit : g_units)
+            {
+                // numbers of solved cells, a number solved twice makes the board invalid
+                __m256i solved = zero, solvedTwice = zero;
+                for (auto cell : unit)
+                {
+                    __m256i number = _mm256_and_si256(cells[cell], singleLanes(cells[cell]));
+                    solvedTwice = _mm256_or_si256(solvedTwice, _mm256_and_si256(solved, number));
+                    solved = _mm256_or_si256(solved, number);
+                }
+
+                // unsolved cells lose solved numbers, candidates found in one and in more cells are collected
+                __m256i once = zero, twice = zero;
+                for (auto cell : unit)
+                {
+                    __m256i candidates = cells[cell];
+                    __m256i reduced = _mm256_andnot_si256(_mm256_andnot_si256(singleLanes(candidates), solved), candidates);
+
+                    changed = _mm256_or_si256(changed, _mm256_xor_si256(reduced, candidates));
+                    invalid = _mm256_or_si256(invalid, _mm256_cmpeq_epi16(reduced, zero));
+                    twice = _mm256_or_si256(twice, _mm256_and_si256(once, reduced));
+                    once = _mm256_or_si256(once, reduced);
+                    cells[cell] = reduced;
+                }
+
+                // each number must have a cell in the unit
+                invalid = _mm256_or_si256(invalid, _mm256_or_si256(solvedTwice, _mm256_andnot_si256(once, allCandidates)));
+
+                // unsolved numbers which can be only in one cell of the unit
+                __m256i hidden = _mm256_andnot_si256(_mm256_or_si256(twice, solved), once);
+                if (_mm256_testz_si256(hidden, hidden))
+                    continue;
+
+                for (auto cell : unit)
+                {
+                    __m256i candidates = cells[cell];
+                    __m256i found = _mm256_and_si256(candidates, hidden);
+                    __m256i reduced = _mm256_blendv_epi8(found, candidates, _mm256_cmpeq_epi16(found, zero));
+
+                    changed = _mm256_or_si256(changed, _mm256_xor_si256(reduced, candidates));
+                    cells[cell] = reduced;
+                }
+            }
+
+            // invalid boards don't need to settle
+            if (_mm256_testz_si256(changed, _mm256_cmpeq_epi16(invalid, zero)))
+                break;
+        }
+
+        alignas(32) uint16_t invalidLanes[BATCH_LANES];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(invalidLanes), invalid);
+        for (size_t lane = 0; lane < BATCH_LANES; ++lane)
+            results[lane] = invalidLanes[lane] ? Propagation::Invalid : Propagation::Solved;
+
+        for (size_t cell = 0; cell < G::CELLS_COUNT; ++cell)
+        {
+            alignas(32) uint16_t lanes[BATCH_LANES];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), cells[cell]);
+
+            for (size_t lane = 0; lane < BATCH_LANES; ++lane)
+            {
+                bool single = countCandidates(lanes[lane]) == 1;
+                propagated[lane][cell / BOARD_SIZE][cell % BOARD_SIZE] = single ? firstCandidate(lanes[lane]) : 0;
+                if (!single && results[lane] == Propagation::Solved)
+                    results[lane] = Propagation::Open;
+            }
+        }
+    }
+#endif
+
+    // calls finish(index, board, propagation) for each board, board has numbers in cells which propagation left
+    // with a single candidate, without AVX2 it is the board itself and propagation is Open
+    template<class G, class Finish>
+    void propagateBatch(std::span<const typename G::Board> boards, Finish finish)
+    {
+#ifdef SUDOKU_SIMD_X86
+        if constexpr (std::is_same_v<G, Geometry9>)
+        {
+            static const bool avx2 = hasAvx2();
+            if (avx2)
+            {
+                std::array<const Board*, BATCH_LANES> lanes;
+                std::array<Board, BATCH_LANES> propagated;
+                std::array<Propagation, BATCH_LANES> results;
+
+                for (size_t first = 0; first < boards.size(); first += BATCH_LANES)
+                {
+                    size_t count = std::min(BATCH_LANES, boards.size() - first);
+                    // lanes after the last board repeat it
+                    for (size_t lane = 0; lane < BATCH_LANES; ++lane)
+                        lanes[lane] = &boards[first + std::min(lane, count - 1)];
+
+                    propagateAvx2(lanes.data(), propagated.data(), results.data());
+
+                    for (size_t lane = 0; lane < count; ++lane)
+                        finish(first + lane, propagated[lane], results[lane]);
+                }
+                return;
+            }
+        }
+#endif
+        for (size_t i = 0; i < boards.size(); ++i)
+            finish(i, boards[i], Propagation::Open);
+    }
+
+    template<class G>
+    void solveBatch(std::span<const typename G::Board> boards, std::span<std::optional<typename G::Board>> solutions)
+    {
+        assert(solutions.size() >= boards.size());
+
+        auto& solver = getSolver<G>(getSolverBackend());
+        propagateBatch<G>(boards, [&](size_t i, const typename G::Board& board, Propagation propagation)
+        {
+            if (propagation == Propagation::Invalid)
+                solutions[i].reset();
+            else if (propagation == Propagation::Solved)
+                solutions[i] = board;
+            else
+                solutions[i] = solver.solve(board);
+        });
+    }
+
+    template<class G>
+    void countSolutionsBatch(std::span<const typename G::Board> boards, std::span<size_t> counts, size_t limit)
+    {
+        assert(counts.size() >= boards.size());
+
+        auto& solver = getSolver<G>(getSolverBackend());
+        propagateBatch<G>(boards, [&](size_t i, const typename G::Board& board, Propagation propagation)
+        {
+            if (propagation == Propagation::Invalid)
+                counts[i] = 0;
+            else if (propagation == Propagation::Solved)
+                counts[i] = std::min<size_t>(limit, 1);
+            else
+                counts[i] = solver.countSolutions(board, limit, nullptr);
+        });
+    }
+
+#define SUDOKU_INSTANTIATE(G) \
+    template void solveBatch<G>(std::span<const G::Board> boards, std::span<std::optional<G::Board>> solutions); \
+    template void countSolutionsBatch<G>(std::span<const G::Board> boards, std::span<size_t> counts, size_t limit);
+
+    SUDOKU_FOR_EACH_GEOMETRY(SUDOKU_INSTANTIATE)
+#undef SUDOKU_INSTANTIATE
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include "sudoku.h"
+#include <span>
+
+namespace Sudoku
+{
+    // boards are solved by constraint propagation (naked and hidden singles) in lockstep, 16 boards at once,
+    // candidates of one cell of all boards are interleaved in one AVX2 vector, so each lane is one board
+    // boards which need guessing are finished one by one by the selected solver backend from the propagated
+    // board, other geometries and CPUs without AVX2 solve all boards one by one
+
+    // solutions[i] is a solution of boards[i], none if it has none (solutions must be as long as boards)
+    template<class G = Geometry9>
+    void solveBatch(std::span<const typename G::Board> boards, std::span<std::optional<typename G::Board>> solutions);
+    // counts[i] is countSolutions(boards[i], limit) (counts must be as long as boards)
+    template<class G = Geometry9>
+    void countSolutionsBatch(std::span<const typename G::Board> boards, std::span<size_t> counts, size_t limit = 2);
+}
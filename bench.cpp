@@ -0,0 +1,535 @@
+#include "sudoku.h"
+#include "candidates.h"
+#include "corpus.h"
+#include "symmetry.h"
+#include "batchsolver.h"
+#include "cache.h"
+#include <benchmark/benchmark.h>
+#include <map>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+
+// all benchmarks take number of spaces as the first argument, benchmark.py plots time against it
+
+// every heap allocation is counted, benchmarks report allocations per iteration of their loop
+// (generation and solving must not allocate, their benchmarks fail if they do)
+static std::atomic<int64_t> g_allocations{ 0 };
+
+// all replaceable forms go through these two, so every allocation is counted and freed by the matching
+// function, they are not inlined, otherwise gcc sees free of memory from new (-Wmismatched-new-delete)
+[[gnu::noinline]] static void* allocate(size_t size, size_t alignment)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+
+    // aligned_alloc needs size which is a multiple of the alignment
+    alignment = std::max(alignment, alignof(std::max_align_t));
+    size = (std::max<size_t>(size, 1) + alignment - 1) / alignment * alignment;
+    if (void* result = std::aligned_alloc(alignment, size))
+        return result;
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] static void deallocate(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void* operator new(size_t size) { return allocate(size, 0); }
+void* operator new[](size_t size) { return allocate(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment) { return allocate(size, size_t(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment) { return allocate(size, size_t(alignment)); }
+
+void operator delete(void* pointer) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, size_t) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { deallocate(pointer); }
+
+static int64_t allocationsCount()
+{
+    return g_allocations.load(std::memory_order_relaxed);
+}
+
+static void reportAllocations(benchmark::State& state, int64_t start)
+{
+    state.counters["allocations"] = benchmark::Counter(double(allocationsCount() - start), benchmark::Counter::kAvgIterations);
+}
+
+// for benchmarks of code which must not allocate, the benchmark fails if it did
+static void requireNoAllocations(benchmark::State& state, int64_t start)
+{
+    // before the counter is added, it allocates too
+    bool allocated = allocationsCount() != start;
+    reportAllocations(state, start);
+    if (allocated)
+        state.SkipWithError("heap allocation on hot path");
+}
+
+static const uint64_t SEED = 1;
+static const size_t PUZZLES_COUNT = 16;
+
+struct Puzzles
+{
+    std::vector<Sudoku::Board> boards;
+    std::vector<Sudoku::Board> solutions;
+};
+
+// the same set of puzzles for the given spaces in every run
+static const Puzzles& getPuzzles(size_t spaces)
+{
+    static std::map<size_t, Puzzles> cache;
+
+    auto& result = cache[spaces];
+    if (result.boards.empty())
+    {
+        Sudoku::Generator generator(SEED + spaces);
+        for (size_t i = 0; i < PUZZLES_COUNT; ++i)
+        {
+            auto [board, solution] = Sudoku::generateSudoku(spaces, generator);
+            result.boards.push_back(board);
+            result.solutions.push_back(solution);
+        }
+    }
+
+    return result;
+}
+
+// items per second are grids per second
+template<class G>
+static void BM_GenerateGrid(benchmark::State& state)
+{
+    Sudoku::Generator generator(SEED);
+    int64_t allocations = allocationsCount();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Sudoku::generateGrid<G>(generator));
+
+    requireNoAllocations(state, allocations);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_GenerateGrid, Sudoku::Geometry9)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_GenerateGrid, Sudoku::Geometry16)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_GenerateGrid, Sudoku::Geometry25)->Unit(benchmark::kMillisecond);
+
+static void BM_RemoveSpaces(benchmark::State& state)
+{
+    Sudoku::Generator generator(SEED);
+    // puzzles without spaces, only solutions are used
+    const auto& puzzles = getPuzzles(0);
+    size_t i = 0, failed = 0;
+
+    int64_t allocations = allocationsCount();
+    for (auto _ : state)
+    {
+        auto board = puzzles.solutions[i++ % PUZZLES_COUNT];
+        if (!Sudoku::removeSpaces(board, state.range(0), generator))
+            failed++;
+        benchmark::DoNotOptimize(board);
+    }
+
+    requireNoAllocations(state, allocations);
+
+    state.counters["failed"] = benchmark::Counter(double(failed), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_RemoveSpaces)->DenseRange(20, 60, 5)->Unit(benchmark::kMicrosecond);
+
+static void BM_SolveRandomBoard(benchmark::State& state)
+{
+    const auto& puzzles = getPuzzles(state.range(0));
+    size_t i = 0;
+
+    int64_t allocations = allocationsCount();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Sudoku::solveRandomBoard(puzzles.boards[i++ % PUZZLES_COUNT]));
+
+    requireNoAllocations(state, allocations);
+}
+BENCHMARK(BM_SolveRandomBoard)->DenseRange(20, 60, 5)->Unit(benchmark::kMicrosecond);
+
+static void BM_GetSolutions(benchmark::State& state)
+{
+    const auto& puzzles = getPuzzles(state.range(0));
+    std::vector<Sudoku::Board> solutions;
+    size_t i = 0;
+
+    // the vector keeps its capacity after the first call
+    auto first = puzzles.boards[0];
+    Sudoku::getSolutions(first, solutions);
+
+    int64_t allocations = allocationsCount();
+    for (auto _ : state)
+    {
+        auto board = puzzles.boards[i++ % PUZZLES_COUNT];
+        solutions.clear();
+        benchmark::DoNotOptimize(Sudoku::getSolutions(board, solutions));
+    }
+
+    requireNoAllocations(state, allocations);
+}
+BENCHMARK(BM_GetSolutions)->DenseRange(20, 60, 5)->Unit(benchmark::kMicrosecond);
+
+// second argument selects solver backend, 0 is backtracking, 1 is dancing links
+static Sudoku::Solver& getSolver(benchmark::State& state)
+{
+    return Sudoku::getSolver(state.range(1) == 0 ? Sudoku::SolverBackend::Backtracking : Sudoku::SolverBackend::DancingLinks);
+}
+
+// uniqueness check, the operation generation spends most of its time in
+static void BM_CountSolutions(benchmark::State& state)
+{
+    const auto& puzzles = getPuzzles(state.range(0));
+    auto& solver = getSolver(state);
+    size_t i = 0;
+
+    int64_t allocations = allocationsCount();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(solver.countSolutions(puzzles.boards[i++ % PUZZLES_COUNT], 2, nullptr));
+
+    requireNoAllocations(state, allocations);
+}
+BENCHMARK(BM_CountSolutions)->ArgsProduct({ benchmark::CreateDenseRange(20, 60, 10), { 0, 1 } })->Unit(benchmark::kMicrosecond);
+
+// well known hard puzzles (AI Escargot, Golden Nugget, Easter Monster) and minimal ones with 17 clues
+static const char* HARD_PUZZLES[] =
+{
+    "100007090030020008009600500005300900010080002600004000300000010040000007007000300",
+    "000000039000001005003050800008090006070002000100400000009080050020000600400700000",
+    "100000002090400050006000700050903000000070000000850040700000600030009080002000001",
+    "000000010400000000020000000000050407008000300001090000300400200050100000000806000",
+    "000000012000035000000600070700000300000400800100000000000120000080000040050000600",
+    "000000012003600000000007000410020000000500300700000600280000040000300500000000000",
+};
+
+// hard puzzles grouped by their spaces
+static const std::map<size_t, std::vector<Sudoku::Board>>& getHardPuzzles()
+{
+    static const auto result = []()
+    {
+        std::map<size_t, std::vector<Sudoku::Board>> puzzles;
+        for (auto line : HARD_PUZZLES)
+        {
+            auto board = *Sudoku::boardFromLine(line);
+
+            size_t spaces = 0;
+            for (const auto& row : board)
+                spaces += std::count(std::begin(row), std::end(row), 0);
+
+            puzzles[spaces].push_back(board);
+        }
+        return puzzles;
+    }();
+
+    return result;
+}
+
+static void applyHardPuzzles(benchmark::internal::Benchmark* benchmark)
+{
+    for (const auto& [spaces, puzzles] : getHardPuzzles())
+    {
+        benchmark->Args({ int64_t(spaces), 0 });
+        benchmark->Args({ int64_t(spaces), 1 });
+    }
+}
+
+static void BM_SolveHard(benchmark::State& state)
+{
+    const auto& puzzles = getHardPuzzles().at(state.range(0));
+    auto& solver = getSolver(state);
+    size_t i = 0;
+
+    int64_t allocations = allocationsCount();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(solver.solve(puzzles[i++ % puzzles.size()]));
+
+    requireNoAllocations(state, allocations);
+}
+BENCHMARK(BM_SolveHard)->Apply(applyHardPuzzles)->Unit(benchmark::kMicrosecond);
+
+static void BM_CountSolutionsHard(benchmark::State& state)
+{
+    const auto& puzzles = getHardPuzzles().at(state.range(0));
+    auto& solver = getSolver(state);
+    size_t i = 0;
+
+    int64_t allocations = allocationsCount();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(solver.countSolutions(puzzles[i++ % puzzles.size()], 2, nullptr));
+
+    requireNoAllocations(state, allocations);
+}
+BENCHMARK(BM_CountSolutionsHard)->Apply(applyHardPuzzles)->Unit(benchmark::kMicrosecond);
+
+static void BM_ComputeDifficulty(benchmark::State& state)
+{
+    const auto& puzzles = getPuzzles(state.range(0));
+    size_t i = 0;
+
+    int64_t allocations = allocationsCount();
+    for (auto _ : state)
+    {
+        size_t index = i++ % PUZZLES_COUNT;
+        benchmark::DoNotOptimize(Sudoku::computeDifficulty(puzzles.solutions[index], puzzles.boards[index]));
+    }
+
+    requireNoAllocations(state, allocations);
+}
+BENCHMARK(BM_ComputeDifficulty)->DenseRange(20, 60, 5)->Unit(benchmark::kMicrosecond);
+
+// second argument selects implementation, 0 is scalar, 1 is AVX2, 2 is SSE4.1
+static void BM_ScanBoard(benchmark::State& state)
+{
+    const auto& puzzles = getPuzzles(state.range(0));
+    std::vector<Sudoku::BoardMasks<Sudoku::Geometry9>> masks(std::begin(puzzles.boards), std::end(puzzles.boards));
+    Sudoku::BoardScan<Sudoku::Geometry9> scan;
+    size_t i = 0;
+
+    auto scanBoard = Sudoku::scanBoardScalar<Sudoku::Geometry9>;
+#ifdef SUDOKU_SIMD_X86
+    if (state.range(1) == 1 && Sudoku::hasAvx2())
+        scanBoard = Sudoku::scanBoardAvx2;
+    if (state.range(1) == 2 && Sudoku::hasSse41())
+        scanBoard = Sudoku::scanBoardSse41;
+#endif
+    if (state.range(1) != 0 && scanBoard == Sudoku::scanBoardScalar<Sudoku::Geometry9>)
+    {
+        state.SkipWithError(state.range(1) == 1 ? "AVX2 is not supported" : "SSE4.1 is not supported");
+        return;
+    }
+
+    int64_t allocations = allocationsCount();
+    for (auto _ : state)
+    {
+        size_t index = i++ % PUZZLES_COUNT;
+        scanBoard(puzzles.boards[index], masks[index], scan);
+        benchmark::DoNotOptimize(scan);
+    }
+
+    requireNoAllocations(state, allocations);
+}
+BENCHMARK(BM_ScanBoard)->ArgsProduct({ benchmark::CreateDenseRange(20, 60, 10), { 0, 1, 2 } });
+
+// second argument enables row / column elimination
+static void BM_SolveSudoku(benchmark::State& state)
+{
+    const auto& puzzles = getPuzzles(state.range(0));
+    bool allowRowColElimination = state.range(1) != 0;
+    size_t i = 0, solved = 0;
+
+    int64_t allocations = allocationsCount();
+    for (auto _ : state)
+    {
+        if (Sudoku::solveSudoku(puzzles.boards[i++ % PUZZLES_COUNT], allowRowColElimination))
+            solved++;
+    }
+
+    requireNoAllocations(state, allocations);
+
+    state.counters["solved"] = benchmark::Counter(double(solved), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_SolveSudoku)->ArgsProduct({ benchmark::CreateDenseRange(20, 60, 5), { 0, 1 } })->Unit(benchmark::kMicrosecond);
+
+// all techniques, score is the average score of the hardest technique
+static void BM_SolveHuman(benchmark::State& state)
+{
+    const auto& puzzles = getPuzzles(state.range(0));
+    size_t i = 0, solved = 0, score = 0;
+
+    int64_t allocations = allocationsCount();
+    for (auto _ : state)
+    {
+        auto solution = Sudoku::solveHuman(puzzles.boards[i++ % PUZZLES_COUNT]);
+        solved += solution.solved;
+        score += solution.score;
+    }
+
+    requireNoAllocations(state, allocations);
+
+    state.counters["solved"] = benchmark::Counter(double(solved), benchmark::Counter::kAvgIterations);
+    state.counters["score"] = benchmark::Counter(double(score), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_SolveHuman)->DenseRange(20, 60, 5)->Unit(benchmark::kMicrosecond);
+
+// spaces aren't given, the minimal puzzle decides them, so the argument is the least count of spaces
+static void BM_GenerateMinimalSudoku(benchmark::State& state)
+{
+    Sudoku::Generator generator(SEED);
+    int64_t allocations = allocationsCount();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Sudoku::generateMinimalSudoku(state.range(0), generator));
+
+    requireNoAllocations(state, allocations);
+}
+BENCHMARK(BM_GenerateMinimalSudoku)->DenseRange(0, 58, 58)->Arg(59)->Unit(benchmark::kMillisecond);
+
+static void BM_GenerateSudoku(benchmark::State& state)
+{
+    Sudoku::Generator generator(SEED);
+    int64_t allocations = allocationsCount();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Sudoku::generateSudoku(state.range(0), generator));
+
+    requireNoAllocations(state, allocations);
+}
+BENCHMARK(BM_GenerateSudoku)->DenseRange(20, 55, 5)->Unit(benchmark::kMillisecond);
+
+// bigger boards, geometry is the template argument
+template<class G>
+static void BM_GenerateSudokuGeometry(benchmark::State& state)
+{
+    Sudoku::Generator generator(SEED);
+    int64_t allocations = allocationsCount();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Sudoku::generateSudoku<G>(state.range(0), generator));
+
+    requireNoAllocations(state, allocations);
+}
+BENCHMARK_TEMPLATE(BM_GenerateSudokuGeometry, Sudoku::Geometry16)->DenseRange(40, 120, 20)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_GenerateSudokuGeometry, Sudoku::Geometry25)->DenseRange(100, 250, 50)->Unit(benchmark::kMillisecond);
+
+// arguments are spaces and threads testing removals at once, latency of a single puzzle
+template<class G>
+static void BM_RemoveSpacesThreads(benchmark::State& state)
+{
+    static const size_t SOLUTIONS_COUNT = 8;
+
+    Sudoku::Generator generator(SEED);
+    std::vector<typename G::Board> solutions;
+    for (size_t i = 0; i < SOLUTIONS_COUNT; ++i)
+        solutions.push_back(Sudoku::generateGrid<G>(generator));
+
+    // workers are started by the first call and kept for the next ones
+    auto first = solutions[0];
+    Sudoku::removeSpaces<G>(first, state.range(0), generator, state.range(1));
+
+    size_t i = 0;
+    int64_t allocations = allocationsCount();
+    for (auto _ : state)
+    {
+        auto board = solutions[i++ % SOLUTIONS_COUNT];
+        benchmark::DoNotOptimize(Sudoku::removeSpaces<G>(board, state.range(0), generator, state.range(1)));
+    }
+
+    requireNoAllocations(state, allocations);
+}
+BENCHMARK_TEMPLATE(BM_RemoveSpacesThreads, Sudoku::Geometry9)->ArgsProduct({ { 50, 55 }, { 1, 2, 4 } })->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_RemoveSpacesThreads, Sudoku::Geometry16)->ArgsProduct({ { 80, 120 }, { 1, 2, 4 } })->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// arguments are spaces, minDifficulty, maxDifficulty and search (0 hill climb, 1 annealing)
+static void BM_GenerateSudokuWithDifficulty(benchmark::State& state)
+{
+    auto search = Sudoku::getDifficultySearch();
+    Sudoku::setDifficultySearch(state.range(3) == 0 ? Sudoku::DifficultySearch::HillClimb : Sudoku::DifficultySearch::Annealing);
+
+    Sudoku::Generator generator(SEED);
+    int64_t allocations = allocationsCount();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Sudoku::generateSudokuWithDifficulty(state.range(0), state.range(1), state.range(2), generator));
+
+    requireNoAllocations(state, allocations);
+    Sudoku::setDifficultySearch(search);
+}
+// only bands which are reachable for the given spaces, otherwise generation never ends
+BENCHMARK(BM_GenerateSudokuWithDifficulty)
+    ->Apply([](benchmark::internal::Benchmark* benchmark)
+    {
+        for (int64_t search = 0; search <= 1; ++search)
+        {
+            for (int64_t spaces = 40; spaces <= 55; spaces += 5)
+            {
+                benchmark->Args({ spaces, 150, 200, search });
+                benchmark->Args({ spaces, 100, 150, search });
+            }
+            benchmark->Args({ 50, 90, 100, search });
+            benchmark->Args({ 55, 90, 100, search });
+        }
+    })
+    ->Unit(benchmark::kMillisecond);
+
+// arguments are spaces, time of one variant
+static void BM_MultiplyPuzzle(benchmark::State& state)
+{
+    static const size_t VARIANTS_COUNT = 100;
+
+    Sudoku::Generator generator(SEED);
+    const auto& puzzles = getPuzzles(state.range(0));
+    size_t i = 0;
+
+    for (auto _ : state)
+    {
+        size_t p = i++ % PUZZLES_COUNT;
+        benchmark::DoNotOptimize(Sudoku::multiplyPuzzle(puzzles.boards[p], puzzles.solutions[p], VARIANTS_COUNT, generator));
+    }
+
+    state.SetItemsProcessed(state.iterations() * VARIANTS_COUNT);
+}
+BENCHMARK(BM_MultiplyPuzzle)->DenseRange(30, 60, 10)->Unit(benchmark::kMicrosecond);
+
+// arguments are spaces, 0 is a full board
+static void BM_CanonicalForm(benchmark::State& state)
+{
+    const auto& puzzles = getPuzzles(state.range(0));
+    size_t i = 0;
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Sudoku::getCanonicalForm(puzzles.boards[i++ % PUZZLES_COUNT]));
+}
+BENCHMARK(BM_CanonicalForm)->DenseRange(0, 60, 10)->Unit(benchmark::kMicrosecond);
+
+// all puzzles of the spaces in one call, items per second is comparable to 1 / time of BM_CountSolutions
+static void BM_CountSolutionsBatch(benchmark::State& state)
+{
+    const auto& puzzles = getPuzzles(state.range(0));
+    std::vector<size_t> counts(PUZZLES_COUNT);
+
+    int64_t allocations = allocationsCount();
+    for (auto _ : state)
+    {
+        Sudoku::countSolutionsBatch(puzzles.boards, counts);
+        benchmark::DoNotOptimize(counts.data());
+    }
+
+    requireNoAllocations(state, allocations);
+    state.SetItemsProcessed(state.iterations() * PUZZLES_COUNT);
+}
+BENCHMARK(BM_CountSolutionsBatch)->DenseRange(20, 60, 10)->Unit(benchmark::kMicrosecond);
+
+static void BM_SolveBatch(benchmark::State& state)
+{
+    const auto& puzzles = getPuzzles(state.range(0));
+    std::vector<std::optional<Sudoku::Board>> solutions(PUZZLES_COUNT);
+
+    int64_t allocations = allocationsCount();
+    for (auto _ : state)
+    {
+        Sudoku::solveBatch(puzzles.boards, solutions);
+        benchmark::DoNotOptimize(solutions.data());
+    }
+
+    requireNoAllocations(state, allocations);
+    state.SetItemsProcessed(state.iterations() * PUZZLES_COUNT);
+}
+BENCHMARK(BM_SolveBatch)->DenseRange(20, 60, 10)->Unit(benchmark::kMicrosecond);
+
+// cache of the second argument entries, third argument 1 for canonical cache, the first pass over
+// the puzzles fills it, so hits are measured (capacity 0 keeps just the last puzzle, so it measures misses)
+static void BM_ValidationCache(benchmark::State& state)
+{
+    const auto& puzzles = getPuzzles(state.range(0));
+    Sudoku::ValidationCache cache(state.range(1), state.range(2) != 0, state.range(1) ? 16 : 1);
+    for (const auto& board : puzzles.boards)
+        cache.validate(board);
+
+    size_t i = 0;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(cache.validate(puzzles.boards[i++ % PUZZLES_COUNT]));
+
+    auto stats = cache.getStats();
+    state.counters["hitRate"] = double(stats.hits) / double(std::max<size_t>(stats.hits + stats.misses, 1));
+}
+BENCHMARK(BM_ValidationCache)->ArgsProduct({ { 30, 50 }, { 0, 1024 }, { 0, 1 } })->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
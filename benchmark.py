@@ -1,22 +1,41 @@
+import sys
 import json
 import matplotlib.pyplot as plt
 
+# usage: python benchmark.py [benchmark.json ...]
+# benchmarks are named family/spaces[/other arguments], each family (with its other arguments)
+# is drawn as one line of time against spaces
+
+TO_MICROSECONDS = { 'ns': 1e-3, 'us': 1.0, 'ms': 1e3, 's': 1e6 }
+
 def draw_plot(file_name, style):
     with open(file_name, 'r') as file:
         benchdata = json.load(file)
 
-    x, y = [], []
+    lines = {}
 
     for test in benchdata['benchmarks']:
         name = test['name'].split('/')
+        if len(name) < 2:
+            continue
+
+        label = '/'.join([name[0]] + name[2:])
+        x, y = lines.setdefault(label, ([], []))
         x.append(int(name[1]))
-        y.append(float(test['real_time']))
+        y.append(float(test['real_time']) * TO_MICROSECONDS[test['time_unit']])
+
+    for label, (x, y) in lines.items():
+        plt.plot(x, y, style, label=label if len(lines) > 1 else file_name)
 
-    plt.plot(x, y, style)
     plt.xlabel('spaces')
     plt.ylabel('time in us')
 
-draw_plot('benchmark-solve.json', 'r-')
-draw_plot('benchmark-no-solve.json', 'b-')
+if len(sys.argv) > 1:
+    for file_name in sys.argv[1:]:
+        draw_plot(file_name, '-')
+else:
+    draw_plot('benchmark-solve.json', 'r-')
+    draw_plot('benchmark-no-solve.json', 'b-')
 
+plt.legend()
 plt.show()
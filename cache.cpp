@@ -0,0 +1,176 @@
+#include "cache.h"
+#include <algorithm>
+
+namespace Sudoku
+{
+    Validation validateBoard(const Board& board)
+    {
+        Validation result;
+
+        Board copy = board;
+        std::vector<Board> solutions;
+        result.solutions = getSolutions(copy, solutions, 2);
+        if (result.solutions == 0)
+            return result;
+
+        result.solution = solutions.front();
+        // human solver and difficulty mean something only for unique solution
+        if (result.solutions == 1)
+        {
+            auto human = solveHuman(board);
+            result.humanSolved = human.solved;
+            result.humanScore = human.score;
+            result.difficulty = computeDifficulty(result.solution, board);
+        }
+
+        return result;
+    }
+
+    // board as the cache stores it
+    struct CacheKey
+    {
+        Board board;
+        uint64_t hash = 0;
+        // turns the requested board into the stored one (canonical cache only)
+        Transform transform;
+    };
+
+    static CacheKey makeKey(const ValidationCache& cache, const Board& board)
+    {
+        CacheKey result;
+        result.board = cache.canonical ? getCanonicalForm(board, result.transform) : board;
+        result.hash = hashBoard(result.board);
+        return result;
+    }
+
+    static ValidationCache::Stripe& getStripe(ValidationCache& cache, uint64_t hash)
+    {
+        // low bits pick the bucket of the index
+        return cache.stripes[(hash >> 32) % cache.stripes.size()];
+    }
+
+    static std::optional<Validation> findKey(ValidationCache& cache, const Board& board, const CacheKey& key)
+    {
+        auto& stripe = getStripe(cache, key.hash);
+
+        Validation result;
+        bool sameBoard = true;
+        {
+            std::lock_guard lock(stripe.mutex);
+
+            auto found = stripe.index.find(key.hash);
+            if (found == stripe.index.end() || found->second->key != key.board)
+            {
+                stripe.stats.misses++;
+                return {};
+            }
+
+            stripe.entries.splice(stripe.entries.begin(), stripe.entries, found->second);
+            result = found->second->validation;
+            sameBoard = found->second->board == board;
+
+            stripe.stats.hits++;
+            if (!sameBoard)
+                stripe.stats.transformedHits++;
+        }
+
+        if (cache.canonical && result.solutions)
+            result.solution = transformBoard(result.solution, invertTransform(key.transform));
+        // difficulty depends on the arrangement of the board
+        if (!sameBoard && result.solutions == 1)
+            result.difficulty = computeDifficulty(result.solution, board);
+
+        return result;
+    }
+
+    static void insertKey(ValidationCache& cache, const Board& board, const CacheKey& key, const Validation& validation)
+    {
+        ValidationCache::Entry entry;
+        entry.hash = key.hash;
+        entry.key = key.board;
+        entry.board = board;
+        entry.validation = validation;
+        if (cache.canonical && validation.solutions)
+            entry.validation.solution = transformBoard(validation.solution, key.transform);
+
+        auto& stripe = getStripe(cache, key.hash);
+        std::lock_guard lock(stripe.mutex);
+
+        // another thread may have stored it meanwhile, a colliding board is replaced
+        auto found = stripe.index.find(key.hash);
+        if (found != stripe.index.end())
+        {
+            *found->second = entry;
+            stripe.entries.splice(stripe.entries.begin(), stripe.entries, found->second);
+            return;
+        }
+
+        if (stripe.entries.size() >= cache.stripeCapacity)
+        {
+            stripe.index.erase(stripe.entries.back().hash);
+            stripe.entries.pop_back();
+            stripe.stats.evictions++;
+        }
+
+        stripe.entries.push_front(entry);
+        stripe.index.emplace(key.hash, stripe.entries.begin());
+        stripe.stats.insertions++;
+    }
+
+    ValidationCache::ValidationCache(size_t capacity, bool canonical, size_t stripes)
+        : canonical(canonical), stripes(std::max<size_t>(stripes, 1))
+    {
+        stripeCapacity = std::max<size_t>((capacity + this->stripes.size() - 1) / this->stripes.size(), 1);
+        for (auto& stripe : this->stripes)
+            stripe.index.reserve(stripeCapacity);
+    }
+
+    std::optional<Validation> ValidationCache::find(const Board& board)
+    {
+        return findKey(*this, board, makeKey(*this, board));
+    }
+
+    Validation ValidationCache::validate(const Board& board)
+    {
+        CacheKey key = makeKey(*this, board);
+        if (auto found = findKey(*this, board, key))
+            return *found;
+
+        Validation result = validateBoard(board);
+        insertKey(*this, board, key, result);
+        return result;
+    }
+
+    void ValidationCache::insert(const Board& board, const Validation& validation)
+    {
+        insertKey(*this, board, makeKey(*this, board), validation);
+    }
+
+    void ValidationCache::clear()
+    {
+        for (auto& stripe : stripes)
+        {
+            std::lock_guard lock(stripe.mutex);
+            stripe.entries.clear();
+            stripe.index.clear();
+        }
+    }
+
+    CacheStats ValidationCache::getStats()
+    {
+        CacheStats result;
+
+        for (auto& stripe : stripes)
+        {
+            std::lock_guard lock(stripe.mutex);
+            result.hits += stripe.stats.hits;
+            result.transformedHits += stripe.stats.transformedHits;
+            result.misses += stripe.stats.misses;
+            result.insertions += stripe.stats.insertions;
+            result.evictions += stripe.stats.evictions;
+            result.size += stripe.entries.size();
+        }
+
+        return result;
+    }
+}
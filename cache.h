@@ -0,0 +1,85 @@
+#pragma once
+#include "sudoku.h"
+#include "symmetry.h"
+#include <mutex>
+#include <list>
+#include <unordered_map>
+
+namespace Sudoku
+{
+    // everything a server checks when it is asked to validate a puzzle
+    struct Validation
+    {
+        // number of solutions up to 2 (1 means unique)
+        size_t solutions = 0;
+        // first solution found, only if solutions isn't 0
+        Board solution{};
+        // solveHuman with all techniques
+        bool humanSolved = false;
+        size_t humanScore = 0;
+        // computeDifficulty, 0 if the solution isn't unique
+        size_t difficulty = 0;
+    };
+
+    // tens of microseconds for puzzles, the solver and the human solver take most of it
+    Validation validateBoard(const Board& board);
+
+    struct CacheStats
+    {
+        size_t hits = 0;
+        // hits of a board stored in another arrangement (canonical cache only), their difficulty is computed again
+        size_t transformedHits = 0;
+        size_t misses = 0;
+        size_t insertions = 0;
+        // least recently used boards dropped for new ones
+        size_t evictions = 0;
+        size_t size = 0;
+    };
+
+    // bounded LRU cache of validateBoard, safe to use from many threads
+    // boards are split to stripes by their hash, each stripe has its own lock, list and index, so threads
+    // block each other only when their boards fall into the same stripe
+    // canonical cache stores the canonical form of boards (see getCanonicalForm), so all transformations
+    // of a board share one entry, but each lookup pays for the canonical form
+    struct ValidationCache
+    {
+        struct Entry
+        {
+            uint64_t hash = 0;
+            // stored board (canonical form in canonical cache), compared on lookup, so a hash collision is a miss
+            Board key{};
+            // board whose difficulty is stored (the same as key in plain cache)
+            Board board{};
+            // solution is the solution of key
+            Validation validation;
+        };
+
+        struct Stripe
+        {
+            std::mutex mutex;
+            // most recently used first
+            std::list<Entry> entries;
+            std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+            CacheStats stats;
+        };
+
+        // capacity is split evenly among stripes (rounded up)
+        explicit ValidationCache(size_t capacity, bool canonical = false, size_t stripes = 16);
+
+        ValidationCache(const ValidationCache&) = delete;
+        ValidationCache& operator=(const ValidationCache&) = delete;
+
+        // cached validation of the board, none if it isn't cached
+        std::optional<Validation> find(const Board& board);
+        // cached validation, the board is validated and stored if it isn't cached
+        Validation validate(const Board& board);
+        void insert(const Board& board, const Validation& validation);
+        void clear();
+        // sum of all stripes
+        CacheStats getStats();
+
+        bool canonical = false;
+        size_t stripeCapacity = 1;
+        std::vector<Stripe> stripes;
+    };
+}
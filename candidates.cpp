@@ -0,0 +1,301 @@
+#include "candidates.h"
+#include <limits>
+#include <cstring>
+
+#ifdef SUDOKU_SIMD_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SUDOKU_TARGET_AVX2
+#define SUDOKU_TARGET_SSE41
+#else
+#include <cpuid.h>
+#define SUDOKU_TARGET_AVX2 __attribute__((target("avx2")))
+#define SUDOKU_TARGET_SSE41 __attribute__((target("sse4.1")))
+#endif
+#include <immintrin.h>
+#endif
+
+namespace Sudoku
+{
+    // adds cells [first, first + BOARD_SIZE) given by bits
+    template<class G>
+    void insertRow(CellSet<G>& set, size_t first, uint64_t bits)
+    {
+        set.words[first / 64] |= bits << (first % 64);
+        if (first % 64 + G::BOARD_SIZE > 64)
+            set.words[first / 64 + 1] |= bits >> (64 - first % 64);
+    }
+
+    template<class G>
+    void scanBoardScalar(const typename G::Board& board, const BoardMasks<G>& masks, BoardScan<G>& result)
+    {
+        result.empty = {};
+        result.singles = {};
+        result.leastCandidatesCell = G::CELLS_COUNT;
+
+        size_t leastCount = std::numeric_limits<size_t>::max();
+
+        for (size_t cell = 0; cell < G::CELLS_COUNT; ++cell)
+        {
+            size_t row = cell / G::BOARD_SIZE, col = cell % G::BOARD_SIZE;
+            if (board[row][col] != 0)
+            {
+                result.candidates[cell] = 0;
+                continue;
+            }
+
+            auto candidates = masks.candidates(row, col);
+            size_t count = countCandidates(candidates);
+
+            result.candidates[cell] = candidates;
+            result.empty.insert(cell);
+            if (count == 1)
+                result.singles.insert(cell);
+
+            if (count < leastCount)
+            {
+                leastCount = count;
+                result.leastCandidatesCell = cell;
+            }
+        }
+    }
+
+#ifdef SUDOKU_SIMD_X86
+    bool hasAvx2()
+    {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 1);
+        // OS must save ymm registers
+        bool osxsave = info[2] & (1 << 27), avx = info[2] & (1 << 28);
+        if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+            return false;
+        __cpuidex(info, 7, 0);
+        return info[1] & (1 << 5);
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+
+    bool hasSse41()
+    {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 1);
+        return info[2] & (1 << 19);
+#else
+        return __builtin_cpu_supports("sse4.1");
+#endif
+    }
+
+    // one bit per 16 bit lane which is all ones
+    SUDOKU_TARGET_AVX2 uint64_t laneBits(__m256i lanes)
+    {
+        __m128i packed = _mm_packs_epi16(_mm256_castsi256_si128(lanes), _mm256_extracti128_si256(lanes, 1));
+        return static_cast<uint16_t>(_mm_movemask_epi8(packed));
+    }
+
+    // one board row per vector, lanes 0..8 are cells of the row, the rest is padding
+    SUDOKU_TARGET_AVX2 void scanBoardAvx2(const Board& board, const BoardMasks<Geometry9>& masks, BoardScan<Geometry9>& result)
+    {
+        using G = Geometry9;
+        static const size_t LANES = 16;
+        // loading of the row below expects 9 cells
+        static_assert(BOARD_SIZE == 9);
+
+        result.empty = {};
+        result.singles = {};
+        result.leastCandidatesCell = G::CELLS_COUNT;
+
+        // padding lanes have all numbers used, so they never have candidates
+        alignas(32) uint16_t cols[LANES];
+        alignas(32) uint16_t bandGrids[GRID_COUNT][LANES];
+        alignas(32) uint16_t validLanes[LANES];
+        for (size_t lane = 0; lane < LANES; ++lane)
+        {
+            bool valid = lane < BOARD_SIZE;
+            cols[lane] = valid ? masks.cols[lane] : 0xFFFF;
+            for (size_t band = 0; band < GRID_COUNT; ++band)
+                bandGrids[band][lane] = valid ? masks.grids[band * GRID_COUNT + lane / GRID_COUNT] : 0xFFFF;
+            validLanes[lane] = valid ? 0xFFFF : 0;
+        }
+
+        const __m256i colsVector = _mm256_load_si256(reinterpret_cast<const __m256i*>(cols));
+        const __m256i validVector = _mm256_load_si256(reinterpret_cast<const __m256i*>(validLanes));
+        const __m256i allCandidates = _mm256_set1_epi16(G::ALL_CANDIDATES);
+        const __m256i lowNibble = _mm256_set1_epi8(0x0F);
+        const __m256i lowByte = _mm256_set1_epi16(0x00FF);
+        const __m256i one = _mm256_set1_epi16(1);
+        // population count of every nibble value
+        const __m256i popcountTable = _mm256_setr_epi8(
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+
+        uint16_t leastCount = std::numeric_limits<uint16_t>::max();
+
+        for (size_t row = 0; row < BOARD_SIZE; ++row)
+        {
+            const __m256i gridsVector = _mm256_load_si256(reinterpret_cast<const __m256i*>(bandGrids[row / GRID_COUNT]));
+            __m256i used = _mm256_or_si256(_mm256_set1_epi16(masks.rows[row]), _mm256_or_si256(colsVector, gridsVector));
+
+            // cells of the row widened to 16 bits, empty lanes are all ones
+            __m128i cells = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(board[row].data()));
+            cells = _mm_insert_epi8(cells, board[row][8], 8);
+            __m256i values = _mm256_cvtepu8_epi16(cells);
+            __m256i empty = _mm256_and_si256(_mm256_cmpeq_epi16(values, _mm256_setzero_si256()), validVector);
+
+            __m256i candidates = _mm256_and_si256(_mm256_andnot_si256(used, allCandidates), empty);
+            // padding lanes spill into the next row, which overwrites them, only the last row can't
+            if (row + 1 < BOARD_SIZE)
+            {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(&result.candidates[row * BOARD_SIZE]), candidates);
+            }
+            else
+            {
+                alignas(32) uint16_t rowCandidates[LANES];
+                _mm256_store_si256(reinterpret_cast<__m256i*>(rowCandidates), candidates);
+                std::memcpy(&result.candidates[row * BOARD_SIZE], rowCandidates, BOARD_SIZE * sizeof(G::Candidates));
+            }
+
+            // population count of each 16 bit lane
+            __m256i counts = _mm256_add_epi8(
+                _mm256_shuffle_epi8(popcountTable, _mm256_and_si256(candidates, lowNibble)),
+                _mm256_shuffle_epi8(popcountTable, _mm256_and_si256(_mm256_srli_epi16(candidates, 4), lowNibble)));
+            counts = _mm256_add_epi16(_mm256_and_si256(counts, lowByte), _mm256_srli_epi16(counts, 8));
+
+            __m256i singles = _mm256_and_si256(_mm256_cmpeq_epi16(counts, one), empty);
+            insertRow(result.empty, row * BOARD_SIZE, laneBits(empty));
+            insertRow(result.singles, row * BOARD_SIZE, laneBits(singles));
+
+            // filled and padding lanes are excluded from minimum by setting them to max
+            __m256i rank = _mm256_or_si256(counts, _mm256_andnot_si256(empty, _mm256_set1_epi16(-1)));
+            for (size_t half = 0; half < 2; ++half)
+            {
+                __m128i minimum = _mm_minpos_epu16(half ? _mm256_extracti128_si256(rank, 1) : _mm256_castsi256_si128(rank));
+                uint16_t count = static_cast<uint16_t>(_mm_extract_epi16(minimum, 0));
+                if (count < leastCount)
+                {
+                    leastCount = count;
+                    result.leastCandidatesCell = row * BOARD_SIZE + half * 8 + _mm_extract_epi16(minimum, 1);
+                }
+            }
+        }
+    }
+
+    SUDOKU_TARGET_SSE41 uint64_t laneBitsSse41(__m128i lanes)
+    {
+        return static_cast<uint8_t>(_mm_movemask_epi8(_mm_packs_epi16(lanes, _mm_setzero_si128())));
+    }
+
+    // the same as scanBoardAvx2 with each row split into two vectors, lanes 0..7 and lanes 8..15
+    SUDOKU_TARGET_SSE41 void scanBoardSse41(const Board& board, const BoardMasks<Geometry9>& masks, BoardScan<Geometry9>& result)
+    {
+        using G = Geometry9;
+        static const size_t LANES = 16, HALF_LANES = 8;
+        // loading of the row below expects 9 cells
+        static_assert(BOARD_SIZE == 9);
+
+        result.empty = {};
+        result.singles = {};
+        result.leastCandidatesCell = G::CELLS_COUNT;
+
+        // padding lanes have all numbers used, so they never have candidates
+        alignas(16) uint16_t cols[LANES];
+        alignas(16) uint16_t bandGrids[GRID_COUNT][LANES];
+        alignas(16) uint16_t validLanes[LANES];
+        for (size_t lane = 0; lane < LANES; ++lane)
+        {
+            bool valid = lane < BOARD_SIZE;
+            cols[lane] = valid ? masks.cols[lane] : 0xFFFF;
+            for (size_t band = 0; band < GRID_COUNT; ++band)
+                bandGrids[band][lane] = valid ? masks.grids[band * GRID_COUNT + lane / GRID_COUNT] : 0xFFFF;
+            validLanes[lane] = valid ? 0xFFFF : 0;
+        }
+
+        const __m128i allCandidates = _mm_set1_epi16(G::ALL_CANDIDATES);
+        const __m128i lowNibble = _mm_set1_epi8(0x0F);
+        const __m128i lowByte = _mm_set1_epi16(0x00FF);
+        const __m128i one = _mm_set1_epi16(1);
+        // population count of every nibble value
+        const __m128i popcountTable = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+
+        uint16_t leastCount = std::numeric_limits<uint16_t>::max();
+
+        for (size_t row = 0; row < BOARD_SIZE; ++row)
+        {
+            // cells of the row widened to 16 bits, the second half has only the last cell
+            __m128i values[2] = {
+                _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(board[row].data()))),
+                _mm_cvtsi32_si128(board[row][8]) };
+
+            alignas(16) uint16_t rowCandidates[LANES];
+            uint64_t emptyBits = 0, singleBits = 0;
+
+            for (size_t half = 0; half < 2; ++half)
+            {
+                size_t first = half * HALF_LANES;
+                const __m128i colsVector = _mm_load_si128(reinterpret_cast<const __m128i*>(cols + first));
+                const __m128i gridsVector = _mm_load_si128(reinterpret_cast<const __m128i*>(bandGrids[row / GRID_COUNT] + first));
+                const __m128i validVector = _mm_load_si128(reinterpret_cast<const __m128i*>(validLanes + first));
+                __m128i used = _mm_or_si128(_mm_set1_epi16(masks.rows[row]), _mm_or_si128(colsVector, gridsVector));
+
+                __m128i empty = _mm_and_si128(_mm_cmpeq_epi16(values[half], _mm_setzero_si128()), validVector);
+                __m128i candidates = _mm_and_si128(_mm_andnot_si128(used, allCandidates), empty);
+                _mm_store_si128(reinterpret_cast<__m128i*>(rowCandidates + first), candidates);
+
+                // population count of each 16 bit lane
+                __m128i counts = _mm_add_epi8(
+                    _mm_shuffle_epi8(popcountTable, _mm_and_si128(candidates, lowNibble)),
+                    _mm_shuffle_epi8(popcountTable, _mm_and_si128(_mm_srli_epi16(candidates, 4), lowNibble)));
+                counts = _mm_add_epi16(_mm_and_si128(counts, lowByte), _mm_srli_epi16(counts, 8));
+
+                __m128i singles = _mm_and_si128(_mm_cmpeq_epi16(counts, one), empty);
+                emptyBits |= laneBitsSse41(empty) << first;
+                singleBits |= laneBitsSse41(singles) << first;
+
+                // filled and padding lanes are excluded from minimum by setting them to max
+                __m128i minimum = _mm_minpos_epu16(_mm_or_si128(counts, _mm_andnot_si128(empty, _mm_set1_epi16(-1))));
+                uint16_t count = static_cast<uint16_t>(_mm_extract_epi16(minimum, 0));
+                if (count < leastCount)
+                {
+                    leastCount = count;
+                    result.leastCandidatesCell = row * BOARD_SIZE + first + _mm_extract_epi16(minimum, 1);
+                }
+            }
+
+            std::memcpy(&result.candidates[row * BOARD_SIZE], rowCandidates, BOARD_SIZE * sizeof(G::Candidates));
+            insertRow(result.empty, row * BOARD_SIZE, emptyBits);
+            insertRow(result.singles, row * BOARD_SIZE, singleBits);
+        }
+    }
+#endif
+
+    template<class G>
+    void scanBoard(const typename G::Board& board, const BoardMasks<G>& masks, BoardScan<G>& result)
+    {
+#ifdef SUDOKU_SIMD_X86
+        if constexpr (std::is_same_v<G, Geometry9>)
+        {
+            static const bool avx2 = hasAvx2(), sse41 = hasSse41();
+            if (avx2)
+            {
+                scanBoardAvx2(board, masks, result);
+                return;
+            }
+            if (sse41)
+            {
+                scanBoardSse41(board, masks, result);
+                return;
+            }
+        }
+#endif
+        scanBoardScalar(board, masks, result);
+    }
+
+#define SUDOKU_INSTANTIATE(G) \
+    template void scanBoard<G>(const G::Board& board, const BoardMasks<G>& masks, BoardScan<G>& result); \
+    template void scanBoardScalar<G>(const G::Board& board, const BoardMasks<G>& masks, BoardScan<G>& result);
+
+    SUDOKU_FOR_EACH_GEOMETRY(SUDOKU_INSTANTIATE)
+#undef SUDOKU_INSTANTIATE
+}
@@ -0,0 +1,265 @@
+#pragma once
+#include "sudoku.h"
+#include <bit>
+#include <utility>
+#include <cassert>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SUDOKU_SIMD_X86 1
+#endif
+
+// calls macro for each supported geometry, used for explicit instantiation of templates
+#define SUDOKU_FOR_EACH_GEOMETRY(MACRO) \
+    MACRO(Geometry4) \
+    MACRO(Geometry6) \
+    MACRO(Geometry9) \
+    MACRO(Geometry16) \
+    MACRO(Geometry25)
+
+// bitmask candidate engine shared by the solvers and the generator
+namespace Sudoku
+{
+    template<class G>
+    using Cells = std::array<typename G::Cell, G::CELLS_COUNT>;
+    template<class G>
+    using PeerCells = std::array<typename G::Cell, G::PEERS_COUNT>;
+
+    // cells sharing row, column or grid with each cell
+    template<class G>
+    std::array<PeerCells<G>, G::CELLS_COUNT> computePeers()
+    {
+        std::array<PeerCells<G>, G::CELLS_COUNT> result;
+
+        for (size_t cell = 0; cell < G::CELLS_COUNT; ++cell)
+        {
+            size_t row = cell / G::BOARD_SIZE, col = cell % G::BOARD_SIZE, count = 0;
+
+            for (size_t other = 0; other < G::CELLS_COUNT; ++other)
+            {
+                size_t r = other / G::BOARD_SIZE, c = other % G::BOARD_SIZE;
+                if (other != cell && (r == row || c == col || G::gridIndex(r, c) == G::gridIndex(row, col)))
+                    result[cell][count++] = static_cast<typename G::Cell>(other);
+            }
+
+            assert(count == G::PEERS_COUNT);
+        }
+
+        return result;
+    }
+
+    template<class G>
+    inline const std::array<PeerCells<G>, G::CELLS_COUNT> g_peers = computePeers<G>();
+
+    template<class Candidates>
+    inline Candidates numberBit(uint8_t number)
+    {
+        return static_cast<Candidates>(Candidates(1) << number);
+    }
+
+    template<class Candidates>
+    inline size_t countCandidates(Candidates candidates)
+    {
+        return std::popcount(candidates);
+    }
+
+    template<class Candidates>
+    inline uint8_t firstCandidate(Candidates candidates)
+    {
+        return static_cast<uint8_t>(std::countr_zero(candidates));
+    }
+
+    // uniform random number in [0, count), same results on all platforms for the same seed
+    size_t random(Generator& generator, size_t count);
+
+    template<class It>
+    void shuffle(It begin, It end, Generator& generator)
+    {
+        for (size_t i = end - begin; i > 1; --i)
+            std::swap(begin[i - 1], begin[random(generator, i)]);
+    }
+
+    // cancellation of the call running on the calling thread, set by public functions which take Cancellation
+    // and checked by the solvers and the generator loops
+    struct CancellationState
+    {
+        const Cancellation* cancellation = nullptr;
+        // clock is read only once in a while by the solvers
+        uint32_t countdown = 0;
+        // stays true once the cancellation stopped the call
+        bool cancelled = false;
+    };
+
+    inline thread_local CancellationState g_cancellationState;
+
+    static const uint32_t CANCELLATION_CHECK_NODES = 256;
+
+    // true if the current call should stop
+    inline bool isCallCancelled()
+    {
+        auto& state = g_cancellationState;
+        if (!state.cancellation || state.cancelled)
+            return state.cancelled;
+
+        state.countdown = CANCELLATION_CHECK_NODES;
+        state.cancelled = state.cancellation->isCancelled();
+        return state.cancelled;
+    }
+
+    // the same, but the cancellation is checked only once per CANCELLATION_CHECK_NODES calls
+    inline bool isSearchCancelled()
+    {
+        auto& state = g_cancellationState;
+        if (!state.cancellation)
+            return false;
+        if (state.cancelled)
+            return true;
+        if (--state.countdown != 0)
+            return false;
+
+        return isCallCancelled();
+    }
+
+    // sets cancellation of the calling thread, the previous one is restored at the end of the scope
+    struct CancellationScope
+    {
+        CancellationState previous;
+
+        explicit CancellationScope(const Cancellation* cancellation) : previous(g_cancellationState)
+        {
+            g_cancellationState = { cancellation, 1, false };
+        }
+
+        ~CancellationScope()
+        {
+            g_cancellationState = previous;
+        }
+
+        CancellationScope(const CancellationScope&) = delete;
+        CancellationScope& operator=(const CancellationScope&) = delete;
+    };
+
+    // numbers used in each row, column and grid of the board
+    // updated incrementally when cell is filled or cleared
+    template<class G>
+    struct BoardMasks
+    {
+        using Candidates = typename G::Candidates;
+
+        std::array<Candidates, G::BOARD_SIZE> rows{};
+        std::array<Candidates, G::BOARD_SIZE> cols{};
+        std::array<Candidates, G::BOARD_SIZE> grids{};
+
+        BoardMasks() {}
+        BoardMasks(const typename G::Board& board)
+        {
+            for (size_t r = 0; r < G::BOARD_SIZE; ++r)
+                for (size_t c = 0; c < G::BOARD_SIZE; ++c)
+                    if (board[r][c] != 0)
+                        set(r, c, board[r][c]);
+        }
+
+        void set(size_t row, size_t col, uint8_t number)
+        {
+            Candidates bit = numberBit<Candidates>(number);
+            rows[row] |= bit;
+            cols[col] |= bit;
+            grids[G::gridIndex(row, col)] |= bit;
+        }
+
+        void clear(size_t row, size_t col, uint8_t number)
+        {
+            Candidates bit = ~numberBit<Candidates>(number);
+            rows[row] &= bit;
+            cols[col] &= bit;
+            grids[G::gridIndex(row, col)] &= bit;
+        }
+
+        Candidates candidates(size_t row, size_t col) const
+        {
+            return G::ALL_CANDIDATES & ~(rows[row] | cols[col] | grids[G::gridIndex(row, col)]);
+        }
+    };
+
+    // set of cells as a bitmask, iterated in row-major order
+    template<class G>
+    struct CellSet
+    {
+        std::array<uint64_t, (G::CELLS_COUNT + 63) / 64> words{};
+
+        void insert(size_t cell)
+        {
+            words[cell / 64] |= uint64_t(1) << (cell % 64);
+        }
+
+        void erase(size_t cell)
+        {
+            words[cell / 64] &= ~(uint64_t(1) << (cell % 64));
+        }
+
+        bool contains(size_t cell) const
+        {
+            return (words[cell / 64] >> (cell % 64)) & 1;
+        }
+
+        size_t size() const
+        {
+            size_t result = 0;
+            for (auto word : words)
+                result += std::popcount(word);
+            return result;
+        }
+
+        bool empty() const
+        {
+            for (auto word : words)
+                if (word)
+                    return false;
+            return true;
+        }
+
+        // first cell in row-major order, CELLS_COUNT if the set is empty
+        size_t first() const
+        {
+            for (size_t w = 0; w < words.size(); ++w)
+                if (words[w])
+                    return w * 64 + std::countr_zero(words[w]);
+            return G::CELLS_COUNT;
+        }
+
+        template<class Function>
+        void forEach(Function function) const
+        {
+            for (size_t w = 0; w < words.size(); ++w)
+                for (uint64_t bits = words[w]; bits; bits &= bits - 1)
+                    function(w * 64 + std::countr_zero(bits));
+        }
+    };
+
+    // candidates of all cells computed in a single pass, together with
+    // empty cells, naked singles and the first cell with least candidates
+    template<class G>
+    struct BoardScan
+    {
+        // 0 for filled cells
+        std::array<typename G::Candidates, G::CELLS_COUNT> candidates;
+        CellSet<G> empty;
+        CellSet<G> singles;
+        // first empty cell in row-major order with least candidates, CELLS_COUNT if there is none
+        size_t leastCandidatesCell;
+    };
+
+    // uses the fastest implementation supported by the CPU, AVX2, SSE4.1 or scalar (vectorized only for 9x9)
+    template<class G>
+    void scanBoard(const typename G::Board& board, const BoardMasks<G>& masks, BoardScan<G>& result);
+
+    template<class G>
+    void scanBoardScalar(const typename G::Board& board, const BoardMasks<G>& masks, BoardScan<G>& result);
+#ifdef SUDOKU_SIMD_X86
+    bool hasAvx2();
+    // must be called only if hasAvx2() is true
+    void scanBoardAvx2(const Board& board, const BoardMasks<Geometry9>& masks, BoardScan<Geometry9>& result);
+    bool hasSse41();
+    // must be called only if hasSse41() is true
+    void scanBoardSse41(const Board& board, const BoardMasks<Geometry9>& masks, BoardScan<Geometry9>& result);
+#endif
+}
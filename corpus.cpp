@@ -0,0 +1,59 @@
+#include "corpus.h"
+
+namespace Sudoku
+{
+    std::string boardToLine(const Board& board)
+    {
+        std::string result;
+        result.reserve(BOARD_SIZE * BOARD_SIZE);
+
+        for (const auto& row : board)
+            for (auto value : row)
+                result += static_cast<char>('0' + value);
+
+        return result;
+    }
+
+    std::optional<Board> boardFromLine(std::string_view line)
+    {
+        if (line.size() < BOARD_SIZE * BOARD_SIZE)
+            return {};
+
+        Board result;
+        for (size_t i = 0; i < BOARD_SIZE * BOARD_SIZE; ++i)
+        {
+            int digit = line[i] == '.' ? 0 : line[i] - '0';
+            if (digit < 0 || digit > int(BOARD_SIZE))
+                return {};
+
+            result[i / BOARD_SIZE][i % BOARD_SIZE] = static_cast<uint8_t>(digit);
+        }
+
+        return result;
+    }
+
+    size_t readPuzzles(std::istream& input, std::vector<Board>& puzzles)
+    {
+        size_t invalid = 0;
+        std::string line;
+
+        while (std::getline(input, line))
+        {
+            std::string_view view(line);
+            while (!view.empty() && (view.back() == '\r' || view.back() == ' ' || view.back() == '\t'))
+                view.remove_suffix(1);
+
+            if (view.empty() || view[0] == '#')
+                continue;
+
+            // board must be followed by the end of line or another field
+            auto board = boardFromLine(view);
+            if (board && (view.size() == BOARD_SIZE * BOARD_SIZE || view[BOARD_SIZE * BOARD_SIZE] == ' ' || view[BOARD_SIZE * BOARD_SIZE] == '\t'))
+                puzzles.push_back(*board);
+            else
+                invalid++;
+        }
+
+        return invalid;
+    }
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include "sudoku.h"
+#include <string>
+#include <string_view>
+#include <istream>
+
+namespace Sudoku
+{
+    // one line format: 81 characters row by row, 1-9 for numbers and 0 or . for spaces
+
+    std::string boardToLine(const Board& board);
+    // reads the board from the first 81 characters, the rest of the line is ignored
+    std::optional<Board> boardFromLine(std::string_view line);
+
+    // reads puzzles from the first field of each line, empty lines and lines starting with # are skipped
+    // returns number of lines which are not valid boards
+    size_t readPuzzles(std::istream& input, std::vector<Board>& puzzles);
+}
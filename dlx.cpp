@@ -0,0 +1,262 @@
+#include "dlx.h"
+#include "stats.h"
+
+namespace Sudoku
+{
+    template<class G>
+    DancingLinksSolver<G>::DancingLinksSolver()
+    {
+        // root and column headers form a circular list, columns are empty at first
+        for (size_t node = ROOT; node < FIRST_ROW_NODE; ++node)
+        {
+            nodes[node].left = static_cast<Index>(node == ROOT ? COLUMNS_COUNT : node - 1);
+            nodes[node].right = static_cast<Index>(node == COLUMNS_COUNT ? ROOT : node + 1);
+            nodes[node].up = nodes[node].down = nodes[node].column = static_cast<Index>(node);
+        }
+
+        for (size_t row = 0; row < ROWS_COUNT; ++row)
+        {
+            size_t cell = row / G::BOARD_SIZE, number = row % G::BOARD_SIZE;
+            size_t r = cell / G::BOARD_SIZE, c = cell % G::BOARD_SIZE;
+
+            // column headers of the cell, row, column and grid constraints
+            std::array<size_t, CONSTRAINTS_COUNT> columns =
+            {
+                1 + cell,
+                1 + G::CELLS_COUNT + r * G::BOARD_SIZE + number,
+                1 + 2 * G::CELLS_COUNT + c * G::BOARD_SIZE + number,
+                1 + 3 * G::CELLS_COUNT + G::gridIndex(r, c) * G::BOARD_SIZE + number,
+            };
+
+            size_t first = FIRST_ROW_NODE + row * CONSTRAINTS_COUNT;
+            for (size_t i = 0; i < CONSTRAINTS_COUNT; ++i)
+            {
+                size_t node = first + i, column = columns[i];
+
+                nodes[node].left = static_cast<Index>(first + (i + CONSTRAINTS_COUNT - 1) % CONSTRAINTS_COUNT);
+                nodes[node].right = static_cast<Index>(first + (i + 1) % CONSTRAINTS_COUNT);
+
+                // append to the bottom of the column
+                nodes[node].column = static_cast<Index>(column);
+                nodes[node].up = nodes[column].up;
+                nodes[node].down = static_cast<Index>(column);
+                nodes[nodes[column].up].down = static_cast<Index>(node);
+                nodes[column].up = static_cast<Index>(node);
+                sizes[column]++;
+            }
+        }
+    }
+
+    template<class G>
+    void DancingLinksSolver<G>::cover(size_t column)
+    {
+        nodes[nodes[column].right].left = nodes[column].left;
+        nodes[nodes[column].left].right = nodes[column].right;
+
+        for (size_t i = nodes[column].down; i != column; i = nodes[i].down)
+        {
+            for (size_t j = nodes[i].right; j != i; j = nodes[j].right)
+            {
+                nodes[nodes[j].down].up = nodes[j].up;
+                nodes[nodes[j].up].down = nodes[j].down;
+                sizes[nodes[j].column]--;
+            }
+        }
+    }
+
+    template<class G>
+    void DancingLinksSolver<G>::uncover(size_t column)
+    {
+        for (size_t i = nodes[column].up; i != column; i = nodes[i].up)
+        {
+            for (size_t j = nodes[i].left; j != i; j = nodes[j].left)
+            {
+                sizes[nodes[j].column]++;
+                nodes[nodes[j].down].up = static_cast<Index>(j);
+                nodes[nodes[j].up].down = static_cast<Index>(j);
+            }
+        }
+
+        nodes[nodes[column].right].left = static_cast<Index>(column);
+        nodes[nodes[column].left].right = static_cast<Index>(column);
+    }
+
+    template<class G>
+    bool DancingLinksSolver<G>::isCovered(size_t column) const
+    {
+        return nodes[nodes[column].left].right != column;
+    }
+
+    template<class G>
+    bool DancingLinksSolver<G>::coverGivens()
+    {
+        selectedCount = 0;
+
+        for (size_t cell = 0; cell < G::CELLS_COUNT; ++cell)
+        {
+            uint8_t number = board[cell / G::BOARD_SIZE][cell % G::BOARD_SIZE];
+            if (number == 0)
+                continue;
+
+            // out of range number has no row node, the board has no solution
+            if (number > G::BOARD_SIZE)
+            {
+                givensCount = selectedCount;
+                uncoverGivens();
+                return false;
+            }
+
+            // if some constraint is already covered, the number conflicts with another given
+            size_t first = FIRST_ROW_NODE + (cell * G::BOARD_SIZE + number - 1) * CONSTRAINTS_COUNT;
+            for (size_t i = 0; i < CONSTRAINTS_COUNT; ++i)
+            {
+                if (isCovered(nodes[first + i].column))
+                {
+                    givensCount = selectedCount;
+                    uncoverGivens();
+                    return false;
+                }
+            }
+
+            for (size_t i = 0; i < CONSTRAINTS_COUNT; ++i)
+                cover(nodes[first + i].column);
+            selected[selectedCount++] = static_cast<Index>(first);
+        }
+
+        givensCount = selectedCount;
+        return true;
+    }
+
+    template<class G>
+    void DancingLinksSolver<G>::uncoverGivens()
+    {
+        // in reverse order of covering
+        while (givensCount > 0)
+        {
+            size_t first = selected[--givensCount];
+            for (size_t i = CONSTRAINTS_COUNT; i > 0; --i)
+                uncover(nodes[first + i - 1].column);
+        }
+
+        selectedCount = 0;
+    }
+
+    template<class G>
+    size_t DancingLinksSolver<G>::search(size_t limit, Generator* generator, std::vector<Board>* solutions)
+    {
+        SUDOKU_COUNT(SolverNodes);
+
+        // all constraints are covered, selected rows are the solution
+        if (nodes[ROOT].right == ROOT)
+        {
+            for (size_t i = givensCount; i < selectedCount; ++i)
+            {
+                size_t row = (selected[i] - FIRST_ROW_NODE) / CONSTRAINTS_COUNT;
+                size_t cell = row / G::BOARD_SIZE;
+                board[cell / G::BOARD_SIZE][cell % G::BOARD_SIZE] = static_cast<uint8_t>(row % G::BOARD_SIZE + 1);
+            }
+
+            if (solutions)
+                solutions->push_back(board);
+            return 1;
+        }
+
+        if (isSearchCancelled())
+            return 0;
+
+        // column with least rows
+        size_t column = nodes[ROOT].right;
+        for (size_t c = nodes[column].right; c != ROOT && sizes[column] > 1; c = nodes[c].right)
+        {
+            if (sizes[c] < sizes[column])
+                column = c;
+        }
+
+        if (sizes[column] == 0)
+            return 0;
+
+        // each constraint can be satisfied by at most BOARD_SIZE rows
+        std::array<Index, G::BOARD_SIZE> rows;
+        size_t rowsCount = 0;
+        for (size_t node = nodes[column].down; node != column; node = nodes[node].down)
+            rows[rowsCount++] = static_cast<Index>(node);
+
+        if (generator)
+            shuffle(rows.begin(), rows.begin() + rowsCount, *generator);
+
+        cover(column);
+
+        size_t count = 0;
+        for (size_t r = 0; r < rowsCount && count < limit && failures > 0; ++r)
+        {
+            size_t node = rows[r];
+
+            // first node of the row, solution is written from it
+            selected[selectedCount++] = static_cast<Index>(node - (node - FIRST_ROW_NODE) % CONSTRAINTS_COUNT);
+
+            for (size_t j = nodes[node].right; j != node; j = nodes[j].right)
+                cover(nodes[j].column);
+
+            size_t found = search(limit - count, generator, solutions);
+            if (found == 0)
+                SUDOKU_COUNT(Backtracks);
+            if (found == 0 && failures > 0)
+                failures--;
+            count += found;
+
+            for (size_t j = nodes[node].left; j != node; j = nodes[j].left)
+                uncover(nodes[j].column);
+
+            selectedCount--;
+        }
+
+        uncover(column);
+
+        return count;
+    }
+
+    template<class G>
+    size_t DancingLinksSolver<G>::run(const Board& input, size_t limit, size_t maxFailures, Generator* generator, std::vector<Board>* solutions)
+    {
+        board = input;
+        failures = maxFailures;
+
+        if (limit == 0 || !coverGivens())
+            return 0;
+
+        size_t count = search(limit, generator, solutions);
+        uncoverGivens();
+
+        return count;
+    }
+
+    template<class G>
+    std::optional<typename G::Board> DancingLinksSolver<G>::solve(const Board& input)
+    {
+        if (run(input, 1, std::numeric_limits<size_t>::max(), nullptr, nullptr) == 1)
+            return board;
+
+        return {};
+    }
+
+    template<class G>
+    std::optional<typename G::Board> DancingLinksSolver<G>::solveRandom(const Board& input, Generator& generator, size_t maxFailures)
+    {
+        if (run(input, 1, maxFailures, &generator, nullptr) == 1)
+            return board;
+
+        return {};
+    }
+
+    template<class G>
+    size_t DancingLinksSolver<G>::countSolutions(const Board& input, size_t limit, std::vector<Board>* solutions)
+    {
+        return run(input, limit, std::numeric_limits<size_t>::max(), nullptr, solutions);
+    }
+
+#define SUDOKU_INSTANTIATE(G) \
+    template struct DancingLinksSolver<G>;
+
+    SUDOKU_FOR_EACH_GEOMETRY(SUDOKU_INSTANTIATE)
+#undef SUDOKU_INSTANTIATE
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "sudoku.h"
+#include "candidates.h"
+
+namespace Sudoku
+{
+    // exact cover solver (Knuth's algorithm X with dancing links), each of 4 * CELLS_COUNT constraints
+    // (cell has a number, row / column / grid has each number) must be covered by exactly one of
+    // CELLS_COUNT * BOARD_SIZE rows (324 and 729 for 9x9), links are built once and restored after each search
+    template<class G>
+    struct DancingLinksSolver : BasicSolver<G>
+    {
+        using Board = typename G::Board;
+
+        static const size_t CONSTRAINTS_COUNT = 4;
+        static const size_t COLUMNS_COUNT = CONSTRAINTS_COUNT * G::CELLS_COUNT;
+        static const size_t ROWS_COUNT = G::CELLS_COUNT * G::BOARD_SIZE;
+        // root is followed by column headers, then by nodes of rows
+        static const size_t ROOT = 0;
+        static const size_t FIRST_ROW_NODE = COLUMNS_COUNT + 1;
+        static const size_t NODES_COUNT = FIRST_ROW_NODE + CONSTRAINTS_COUNT * ROWS_COUNT;
+
+        // 16 bits are enough up to 25x25
+        using Index = std::conditional_t<(NODES_COUNT <= 65536), uint16_t, uint32_t>;
+
+        struct Node
+        {
+            Index left;
+            Index right;
+            Index up;
+            Index down;
+            Index column;
+        };
+
+        std::array<Node, NODES_COUNT> nodes;
+        // count of rows in each column, indexed by column header
+        std::array<Index, COLUMNS_COUNT + 1> sizes{};
+
+        // first nodes of selected rows, givens first then rows selected by the search
+        std::array<Index, G::CELLS_COUNT> selected;
+        size_t selectedCount = 0;
+        size_t givensCount = 0;
+
+        // solved board, valid after a search which found a solution
+        Board board;
+        // wrong guesses left, search gives up when it reaches 0
+        size_t failures = 0;
+
+        DancingLinksSolver();
+
+        std::optional<Board> solve(const Board& input) override;
+        std::optional<Board> solveRandom(const Board& input, Generator& generator, size_t maxFailures) override;
+        size_t countSolutions(const Board& input, size_t limit, std::vector<Board>* solutions) override;
+
+        void cover(size_t column);
+        void uncover(size_t column);
+        bool isCovered(size_t column) const;
+
+        // covers constraints of numbers on the board, returns false if some of them
+        // conflict or are out of range (links are left untouched then)
+        bool coverGivens();
+        void uncoverGivens();
+
+        size_t search(size_t limit, Generator* generator, std::vector<Board>* solutions);
+        size_t run(const Board& input, size_t limit, size_t maxFailures, Generator* generator, std::vector<Board>* solutions);
+    };
+}
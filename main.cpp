@@ -1,45 +1,582 @@
 #include "sudoku.h"
+#include "batch.h"
+#include "batchsolver.h"
+#include "corpus.h"
+#include "pool.h"
+#include "archive.h"
+#include "symmetry.h"
+#include "stats.h"
 #include <iostream>
-//#include <benchmark/benchmark.h>
-//
-//// Alternatively, can add libraries using linker options.
-//#ifdef _WIN32
-//#pragma comment(lib, "Shlwapi.lib")
-//#ifdef _DEBUG
-//#pragma comment(lib, "benchmarkd.lib")
-//#pragma comment(lib, "benchmark_maind.lib")
-//#else
-//#pragma comment(lib, "benchmark.lib")
-//#pragma comment(lib, "benchmark_main.lib")
-//#endif
-//#endif
-
-//static void BM_GenerateSudoku(benchmark::State& state)
-//{
-//    while(state.KeepRunning())
-//    {
-//        auto [board, solution] = Sudoku::generateSudoku(55);
-//
-//        // TODO single candidate method
-//        while(!Sudoku::solveSudoku(board, true))
-//            std::tie(board, solution) = Sudoku::generateSudoku(55);
-//    }
-//    //state.SetLabel("Solutions(" + std::to_string(solutions) + ") Spaces(" + std::to_string(state.range(0)) + ")");
-//}
-//BENCHMARK(BM_GenerateSudoku)->Unit(benchmark::kMillisecond);
-//
-//BENCHMARK_MAIN();
-
-int main()
+#include <fstream>
+#include <string>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <utility>
+#include <sstream>
+#include <unordered_set>
+#include <charconv>
+#include <string_view>
+
+// non-negative decimal number, none for anything else (sign, other characters, too big value)
+std::optional<size_t> parseNumber(std::string_view text)
+{
+    size_t result = 0;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), result);
+    if (text.empty() || error != std::errc() || end != text.data() + text.size())
+        return {};
+
+    return result;
+}
+
+// numeric argument or defaultValue if it isn't given, valid is set to false if it isn't a number
+size_t argument(int argc, char* argv[], int index, size_t defaultValue, bool& valid)
+{
+    if (index >= argc)
+        return defaultValue;
+
+    auto result = parseNumber(argv[index]);
+    if (!result)
+        valid = false;
+
+    return result.value_or(defaultValue);
+}
+
+// batch <count> [spaces] [minDifficulty] [maxDifficulty] [threads] [seed] [archive]
+// prints one line per puzzle as they are finished: board solution difficulty seed
+// (output is a puzzle corpus which can be read by solve mode)
+// if archive is given, puzzles are written to it in the binary format instead
+int runBatch(int argc, char* argv[])
+{
+    bool valid = true;
+    size_t count = argument(argc, argv, 0, 0, valid);
+    size_t spaces = argument(argc, argv, 1, 55, valid);
+    size_t minDifficulty = argument(argc, argv, 2, 90, valid);
+    size_t maxDifficulty = argument(argc, argv, 3, 100, valid);
+    size_t threads = argument(argc, argv, 4, 0, valid);
+    uint64_t seed = argument(argc, argv, 5, std::random_device{}(), valid);
+
+    if (argc < 1 || !valid)
+    {
+        std::cerr << "usage: batch <count> [spaces] [minDifficulty] [maxDifficulty] [threads] [seed] [archive]\n";
+        return 1;
+    }
+
+    Sudoku::ArchiveWriter archive;
+    if (argc > 6 && !archive.open(argv[6]))
+    {
+        std::cerr << "cannot write " << argv[6] << "\n";
+        return 1;
+    }
+
+    auto stats = Sudoku::generateBatch(count, spaces, minDifficulty, maxDifficulty, threads, seed,
+        [&](const Sudoku::BatchPuzzle& puzzle)
+        {
+            if (argc > 6)
+            {
+                archive.add(puzzle.board, puzzle.solution, puzzle.difficulty);
+                return;
+            }
+
+            std::cout << Sudoku::boardToLine(puzzle.board) << " " << Sudoku::boardToLine(puzzle.solution) << " "
+                << puzzle.difficulty << " " << puzzle.seed << "\n";
+        });
+
+    if (argc > 6 && !archive.close())
+    {
+        std::cerr << "cannot write " << argv[6] << "\n";
+        return 1;
+    }
+
+    for (size_t t = 0; t < stats.threads.size(); ++t)
+    {
+        const auto& thread = stats.threads[t];
+        std::cerr << "thread " << t << ": " << thread.generated << " puzzles (" << thread.stolen << " stolen) in "
+            << thread.seconds << " s, " << thread.generated / std::max(thread.seconds, 1e-9) << " puzzles/s\n";
+    }
+    std::cerr << "total: " << count << " puzzles in " << stats.seconds << " s, "
+        << count / std::max(stats.seconds, 1e-9) << " puzzles/s\n";
+
+    return 0;
+}
+
+// unpack <archive> [minDifficulty] [maxDifficulty]
+// prints puzzles of the binary archive as lines: board solution difficulty
+// without difficulties in the order in which they were written, otherwise in the order of difficulty
+int runUnpack(int argc, char* argv[])
+{
+    bool valid = true;
+    size_t minDifficulty = argument(argc, argv, 1, 0, valid);
+    size_t maxDifficulty = argument(argc, argv, 2, std::numeric_limits<size_t>::max(), valid);
+
+    if (argc < 1 || !valid)
+    {
+        std::cerr << "usage: unpack <archive> [minDifficulty] [maxDifficulty]\n";
+        return 1;
+    }
+
+    Sudoku::ArchiveReader archive;
+    if (!archive.open(argv[0]))
+    {
+        std::cerr << "cannot read " << argv[0] << " or it is not a valid archive\n";
+        return 1;
+    }
+
+    auto print = [](const Sudoku::ArchiveRecordView& record)
+    {
+        std::cout << Sudoku::boardToLine(record.getBoard()) << " " << Sudoku::boardToLine(record.getSolution()) << " "
+            << record.getDifficulty() << "\n";
+    };
+
+    if (argc < 2)
+    {
+        for (size_t i = 0; i < archive.size(); ++i)
+            print(archive[i]);
+    }
+    else
+    {
+        archive.forEachInDifficulty(minDifficulty, maxDifficulty, print);
+    }
+
+    return 0;
+}
+
+// multiply <count> [spaces] [minDifficulty] [maxDifficulty] [seed]
+// generates one puzzle and prints up to count of its transformations with difficulty in the band
+// as lines: board solution difficulty
+int runMultiply(int argc, char* argv[])
+{
+    bool valid = true;
+    size_t count = argument(argc, argv, 0, 0, valid);
+    size_t spaces = argument(argc, argv, 1, 55, valid);
+    size_t minDifficulty = argument(argc, argv, 2, 90, valid);
+    size_t maxDifficulty = argument(argc, argv, 3, 100, valid);
+    uint64_t seed = argument(argc, argv, 4, std::random_device{}(), valid);
+
+    if (argc < 1 || !valid)
+    {
+        std::cerr << "usage: multiply <count> [spaces] [minDifficulty] [maxDifficulty] [seed]\n";
+        return 1;
+    }
+
+    Sudoku::Generator generator(seed);
+
+    auto [board, solution] = Sudoku::generateSudokuWithDifficulty(spaces, minDifficulty, maxDifficulty, generator);
+    auto variants = Sudoku::multiplyPuzzle(board, solution, count, minDifficulty, maxDifficulty, 1000 * count + 1000, generator);
+
+    for (const auto& variant : variants)
+    {
+        std::cout << Sudoku::boardToLine(variant.board) << " " << Sudoku::boardToLine(variant.solution) << " "
+            << variant.difficulty << "\n";
+    }
+    std::cerr << variants.size() << " variants\n";
+
+    return 0;
+}
+
+// minimal <count> [minSpaces] [seed]
+// generates minimal puzzles (no number can be removed without losing unique solution) with at least minSpaces
+// spaces (or the most of 100 grids) and prints them as lines: board solution difficulty spaces
+int runMinimal(int argc, char* argv[])
+{
+    bool valid = true;
+    size_t count = argument(argc, argv, 0, 0, valid);
+    size_t minSpaces = argument(argc, argv, 1, 0, valid);
+    uint64_t seed = argument(argc, argv, 2, std::random_device{}(), valid);
+
+    if (argc < 1 || !valid)
+    {
+        std::cerr << "usage: minimal <count> [minSpaces] [seed]\n";
+        return 1;
+    }
+
+    Sudoku::Generator generator(seed);
+
+    size_t maxSpaces = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto [board, solution] = Sudoku::generateMinimalSudoku(minSpaces, generator);
+
+        size_t spaces = 0;
+        for (const auto& row : board)
+            spaces += std::count(row.begin(), row.end(), 0);
+        maxSpaces = std::max(maxSpaces, spaces);
+
+        std::cout << Sudoku::boardToLine(board) << " " << Sudoku::boardToLine(solution) << " "
+            << Sudoku::computeDifficulty(solution, board) << " " << spaces << "\n";
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cerr << count << " puzzles in " << seconds << " s, most spaces " << maxSpaces << "\n";
+
+    return 0;
+}
+
+// dedupe
+// copies lines of the corpus from standard input except of puzzles which are transformations of an earlier one
+int runDedupe()
+{
+    std::unordered_set<uint64_t> found;
+    size_t duplicates = 0;
+
+    std::string line;
+    while (std::getline(std::cin, line))
+    {
+        auto board = Sudoku::boardFromLine(line);
+        if (board && !found.insert(Sudoku::hashCanonicalForm(*board)).second)
+        {
+            duplicates++;
+            continue;
+        }
+
+        std::cout << line << "\n";
+    }
+    std::cerr << duplicates << " duplicates\n";
+
+    return 0;
+}
+
+template<class Solver>
+void measureSolver(const char* name, const std::vector<Sudoku::Board>& puzzles, Solver solver)
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<double> latencies;
+    latencies.reserve(puzzles.size());
+    size_t solved = 0;
+
+    auto start = Clock::now();
+    for (const auto& puzzle : puzzles)
+    {
+        auto puzzleStart = Clock::now();
+        if (solver(puzzle))
+            solved++;
+        latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - puzzleStart).count());
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::sort(std::begin(latencies), std::end(latencies));
+    auto percentile = [&latencies](double p) { return latencies[static_cast<size_t>(p * (latencies.size() - 1))]; };
+
+    std::cout << name << ": " << puzzles.size() / std::max(seconds, 1e-9) << " puzzles/s, solved "
+        << solved << "/" << puzzles.size() << " (" << 100.0 * solved / puzzles.size() << " %), latency us"
+        << " p50 " << percentile(0.5) << " p90 " << percentile(0.9) << " p99 " << percentile(0.99)
+        << " max " << latencies.back() << "\n";
+}
+
+// all puzzles are solved by one call, so there is no latency per puzzle
+template<class Solver>
+void measureBatchSolver(const char* name, const std::vector<Sudoku::Board>& puzzles, Solver solver)
+{
+    using Clock = std::chrono::steady_clock;
+
+    auto start = Clock::now();
+    size_t solved = solver(puzzles);
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::cout << name << ": " << puzzles.size() / std::max(seconds, 1e-9) << " puzzles/s, solved "
+        << solved << "/" << puzzles.size() << " (" << 100.0 * solved / puzzles.size() << " %)\n";
+}
+
+// solve <file>
+// reads puzzles in one line format (- for stdin) and solves them with each solver
+int runSolve(int argc, char* argv[])
+{
+    if (argc < 1)
+    {
+        std::cerr << "usage: solve <file>\n";
+        return 1;
+    }
+
+    std::vector<Sudoku::Board> puzzles;
+    size_t invalid = 0;
+
+    if (std::string(argv[0]) == "-")
+    {
+        invalid = Sudoku::readPuzzles(std::cin, puzzles);
+    }
+    else
+    {
+        std::ifstream file(argv[0]);
+        if (!file)
+        {
+            std::cerr << "can't open " << argv[0] << "\n";
+            return 1;
+        }
+        invalid = Sudoku::readPuzzles(file, puzzles);
+    }
+
+    std::cout << "puzzles: " << puzzles.size() << ", invalid lines: " << invalid << "\n";
+    if (puzzles.empty())
+        return 1;
+
+    for (auto [name, backend] : { std::pair("backtracking", Sudoku::SolverBackend::Backtracking), std::pair("dlx", Sudoku::SolverBackend::DancingLinks) })
+    {
+        auto& solver = Sudoku::getSolver(backend);
+        measureSolver(name, puzzles, [&solver](const Sudoku::Board& board) { return solver.solve(board).has_value(); });
+        measureSolver((std::string(name) + "-unique").c_str(), puzzles,
+            [&solver](const Sudoku::Board& board) { return solver.countSolutions(board, 2, nullptr) == 1; });
+    }
+    measureSolver("human", puzzles, [](const Sudoku::Board& board) { return Sudoku::solveSudoku(board, true); });
+    measureSolver("human-all-techniques", puzzles, [](const Sudoku::Board& board) { return Sudoku::solveHuman(board).solved; });
+    measureSolver("human-no-elimination", puzzles, [](const Sudoku::Board& board) { return Sudoku::solveSudoku(board, false); });
+
+    measureBatchSolver("batch", puzzles, [](const std::vector<Sudoku::Board>& boards)
+    {
+        std::vector<std::optional<Sudoku::Board>> solutions(boards.size());
+        Sudoku::solveBatch(boards, solutions);
+        return static_cast<size_t>(std::count_if(solutions.begin(), solutions.end(), [](const auto& solution) { return solution.has_value(); }));
+    });
+    measureBatchSolver("batch-unique", puzzles, [](const std::vector<Sudoku::Board>& boards)
+    {
+        std::vector<size_t> counts(boards.size());
+        Sudoku::countSolutionsBatch(boards, counts);
+        return static_cast<size_t>(std::count(counts.begin(), counts.end(), size_t(1)));
+    });
+
+    return 0;
+}
+
+template<class G>
+int generate(size_t spaces)
+{
+    auto [board, solution] = Sudoku::generateSudoku<G>(spaces);
+
+    std::cout << "Difficulty: " << Sudoku::computeDifficulty<G>(solution, board) << "\n";
+    Sudoku::printBoard<G>(board);
+    Sudoku::printBoard<G>(solution);
+
+    return 0;
+}
+
+// generate <size> [spaces] [threads]
+// generates puzzle of size 4, 6 (grids of 2x3 cells), 9, 16 or 25, by default 40 % of the cells are spaces
+// spaces are removed by threads (0 for all cores) testing several cells at once, the puzzle doesn't depend on it
+int runGenerate(int argc, char* argv[])
+{
+    bool valid = true;
+    size_t size = argument(argc, argv, 0, 9, valid);
+    size_t spaces = argument(argc, argv, 1, size * size * 2 / 5, valid);
+    size_t threads = argument(argc, argv, 2, 1, valid);
+
+    // at least one number has to stay, otherwise generation retries forever
+    if (argc < 1 || !valid || spaces >= size * size)
+    {
+        std::cerr << "usage: generate <size> [spaces] [threads] (spaces fewer than size * size)\n";
+        return 1;
+    }
+
+    Sudoku::setRemovalThreads(threads);
+
+    switch (size)
+    {
+    case 4:
+        return generate<Sudoku::Geometry4>(spaces);
+    case 6:
+        return generate<Sudoku::Geometry6>(spaces);
+    case 9:
+        return generate<Sudoku::Geometry9>(spaces);
+    case 16:
+        return generate<Sudoku::Geometry16>(spaces);
+    case 25:
+        return generate<Sudoku::Geometry25>(spaces);
+    }
+
+    std::cerr << "unsupported size " << size << ", use 4, 6, 9, 16 or 25\n";
+    return 1;
+}
+
+// band is spaces:minDifficulty:maxDifficulty[:capacity]
+std::optional<Sudoku::PoolBand> parseBand(std::string_view text)
+{
+    Sudoku::PoolBand band;
+    size_t values[] = { 0, 0, 0, band.capacity };
+    size_t count = 0;
+    while (true)
+    {
+        size_t colon = std::min(text.find(':'), text.size());
+        auto value = parseNumber(text.substr(0, colon));
+        if (!value || count == 4)
+            return {};
+
+        values[count++] = *value;
+        if (colon == text.size())
+            break;
+        text.remove_prefix(colon + 1);
+    }
+
+    if (count < 3 || values[3] == 0)
+        return {};
+
+    band.spaces = values[0];
+    band.minDifficulty = values[1];
+    band.maxDifficulty = values[2];
+    band.capacity = values[3];
+
+    return band;
+}
+
+// serve [threads] [band ...]
+// keeps pools of ready puzzles of each band (55:90:100:16 by default) and answers requests line by line:
+//   get <band>   ok <board> <solution> <difficulty>, waits if the pool is empty
+//   try <band>   same as get, or empty if the pool is empty
+//   stats        band <band> <spaces> <min> <max> ready <size>/<capacity> generated <count> served <count>
+//                misses <count> rate <puzzles/s> generate <s> for each band, followed by end
+//   quit
+// bad requests are answered with error <reason>
+int runServe(int argc, char* argv[])
 {
+    bool valid = true;
+    size_t threads = argument(argc, argv, 0, 0, valid);
+
+    if (!valid)
+    {
+        std::cerr << "usage: serve [threads] [band ...]\n";
+        return 1;
+    }
+
+    std::vector<Sudoku::PoolBand> bands;
+    for (int i = 1; i < argc; ++i)
+    {
+        auto band = parseBand(argv[i]);
+        if (!band)
+        {
+            std::cerr << "invalid band " << argv[i] << ", use spaces:minDifficulty:maxDifficulty[:capacity]\n";
+            return 1;
+        }
+        bands.push_back(*band);
+    }
+    if (bands.empty())
+        bands.push_back(Sudoku::PoolBand());
+
+    Sudoku::PuzzlePool pool(bands, threads);
+
+    std::string line;
+    while (std::getline(std::cin, line))
+    {
+        std::istringstream request(line);
+        std::string command;
+        request >> command;
+
+        if (command.empty())
+            continue;
+
+        if (command == "quit")
+            break;
+
+        if (command == "stats")
+        {
+            auto stats = pool.getStats();
+            for (size_t b = 0; b < stats.size(); ++b)
+            {
+                const auto& band = stats[b];
+                std::cout << "band " << b << " " << band.band.spaces << " " << band.band.minDifficulty << " " << band.band.maxDifficulty
+                    << " ready " << band.size << "/" << band.band.capacity << " generated " << band.generated
+                    << " served " << band.served << " misses " << band.misses << " rate " << band.refillRate
+                    << " generate " << band.generateSeconds << "\n";
+            }
+            std::cout << "end" << std::endl;
+            continue;
+        }
+
+        if (command == "get" || command == "try")
+        {
+            // band 0 if it isn't given
+            std::string text = "0";
+            request >> text;
+
+            auto band = parseNumber(text);
+            if (!band || *band >= pool.bandsCount())
+            {
+                std::cout << "error unknown band " << text << std::endl;
+                continue;
+            }
+
+            if (auto puzzle = pool.take(*band, command == "get"))
+            {
+                std::cout << "ok " << Sudoku::boardToLine(puzzle->board) << " " << Sudoku::boardToLine(puzzle->solution) << " "
+                    << puzzle->difficulty << std::endl;
+            }
+            else
+            {
+                std::cout << "empty" << std::endl;
+            }
+            continue;
+        }
+
+        std::cout << "error unknown command " << command << std::endl;
+    }
+
+    return 0;
+}
+
+int run(int argc, char* argv[])
+{
+    // --solver backtracking|dlx selects solver backend used by all modes
+    if (argc > 2 && std::string(argv[1]) == "--solver")
+    {
+        std::string backend = argv[2];
+        if (backend == "dlx")
+            Sudoku::setSolverBackend(Sudoku::SolverBackend::DancingLinks);
+        else if (backend != "backtracking")
+        {
+            std::cerr << "unknown solver " << backend << ", use backtracking or dlx\n";
+            return 1;
+        }
+
+        argc -= 2;
+        argv += 2;
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "batch")
+        return runBatch(argc - 2, argv + 2);
+    if (argc > 1 && std::string(argv[1]) == "multiply")
+        return runMultiply(argc - 2, argv + 2);
+    if (argc > 1 && std::string(argv[1]) == "minimal")
+        return runMinimal(argc - 2, argv + 2);
+    if (argc > 1 && std::string(argv[1]) == "dedupe")
+        return runDedupe();
+    if (argc > 1 && std::string(argv[1]) == "unpack")
+        return runUnpack(argc - 2, argv + 2);
+    if (argc > 1 && std::string(argv[1]) == "solve")
+        return runSolve(argc - 2, argv + 2);
+    if (argc > 1 && std::string(argv[1]) == "generate")
+        return runGenerate(argc - 2, argv + 2);
+    if (argc > 1 && std::string(argv[1]) == "serve")
+        return runServe(argc - 2, argv + 2);
+
     auto [board, solution] = Sudoku::generateSudokuWithDifficulty(55, 90, 100);
+    auto human = Sudoku::solveHuman(board);
 
-    while(!Sudoku::solveSudoku(board, true))
+    while(!human.solved)
+    {
         std::tie(board, solution) = Sudoku::generateSudokuWithDifficulty(55, 90, 100);
+        human = Sudoku::solveHuman(board);
+    }
 
     size_t difficulty = Sudoku::computeDifficulty(solution, board);
 
-    std::cout << "Difficulty: " << difficulty << "\n";
+    std::cout << "Difficulty: " << difficulty << ", technique score: " << human.score << "\n";
     Sudoku::printBoard(board);
     Sudoku::printBoard(solution);
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    // --stats prints counters and phase timers of all threads as json to stderr at the end
+    // (only if built with SUDOKU_STATS)
+    if (argc > 1 && std::string(argv[1]) == "--stats")
+    {
+        if (!Sudoku::STATS_ENABLED)
+            std::cerr << "stats are not compiled in, build with -DSUDOKU_STATS=ON\n";
+
+        int result = run(argc - 1, argv + 1);
+        std::cerr << Sudoku::statsToJson(Sudoku::getStats()) << "\n";
+        return result;
+    }
+
+    return run(argc, argv);
 }
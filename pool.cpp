@@ -0,0 +1,147 @@
+#include "pool.h"
+#include <algorithm>
+
+namespace Sudoku
+{
+    PuzzlePool::PuzzlePool(const std::vector<PoolBand>& bands, size_t threads)
+        : rings(bands.size()), start(Clock::now())
+    {
+        for (size_t b = 0; b < bands.size(); ++b)
+        {
+            rings[b].stats.band = bands[b];
+            rings[b].puzzles.resize(std::max<size_t>(bands[b].capacity, 1));
+        }
+
+        if (threads == 0)
+            threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+        for (size_t t = 0; t < threads; ++t)
+            workers.emplace_back([this]() { work(); });
+    }
+
+    PuzzlePool::~PuzzlePool()
+    {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        stop.cancel();
+        refill.notify_all();
+        ready.notify_all();
+
+        for (auto& worker : workers)
+            worker.join();
+    }
+
+    size_t PuzzlePool::bandsCount() const
+    {
+        return rings.size();
+    }
+
+    std::optional<PoolPuzzle> PuzzlePool::take(size_t band, bool wait)
+    {
+        std::unique_lock lock(mutex);
+        Ring& ring = rings[band];
+
+        if (ring.size == 0)
+        {
+            ring.stats.misses++;
+            if (!wait)
+                return {};
+
+            ready.wait(lock, [&]() { return ring.size > 0 || stopping; });
+            if (ring.size == 0)
+                return {};
+        }
+
+        PoolPuzzle result = ring.puzzles[ring.head];
+        ring.head = (ring.head + 1) % ring.puzzles.size();
+        ring.size--;
+        ring.stats.served++;
+
+        lock.unlock();
+        refill.notify_one();
+
+        return result;
+    }
+
+    std::vector<PoolBandStats> PuzzlePool::getStats()
+    {
+        std::lock_guard lock(mutex);
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::vector<PoolBandStats> result;
+        for (const auto& ring : rings)
+        {
+            PoolBandStats stats = ring.stats;
+            stats.size = ring.size;
+            stats.refillRate = stats.generated / std::max(seconds, 1e-9);
+            stats.generateSeconds = stats.generated ? ring.stats.generateSeconds / stats.generated : 0.0;
+            result.push_back(stats);
+        }
+
+        return result;
+    }
+
+    size_t PuzzlePool::emptiestBand() const
+    {
+        size_t result = rings.size(), least = std::numeric_limits<size_t>::max();
+
+        for (size_t b = 0; b < rings.size(); ++b)
+        {
+            size_t filled = rings[b].size + rings[b].pending;
+            if (filled < rings[b].puzzles.size() && filled < least)
+            {
+                result = b;
+                least = filled;
+            }
+        }
+
+        return result;
+    }
+
+    void PuzzlePool::work()
+    {
+        Generator generator;
+        std::unique_lock lock(mutex);
+
+        while (true)
+        {
+            size_t band = rings.size();
+            refill.wait(lock, [&]() { return stopping || (band = emptiestBand()) < rings.size(); });
+            if (stopping)
+                break;
+
+            Ring& ring = rings[band];
+            PoolBand settings = ring.stats.band;
+            ring.pending++;
+            lock.unlock();
+
+            auto puzzleStart = Clock::now();
+            auto generated = generateSudokuWithDifficulty(settings.spaces, settings.minDifficulty, settings.maxDifficulty, generator, stop);
+            // best effort puzzle of a stopped worker may be outside of the band
+            bool cancelled = stop.isCancelled();
+
+            PoolPuzzle puzzle;
+            if (!cancelled)
+            {
+                std::tie(puzzle.board, puzzle.solution) = *generated;
+                puzzle.difficulty = computeDifficulty(puzzle.solution, puzzle.board);
+            }
+            double seconds = std::chrono::duration<double>(Clock::now() - puzzleStart).count();
+
+            lock.lock();
+            ring.pending--;
+            if (cancelled)
+                break;
+
+            ring.puzzles[(ring.head + ring.size) % ring.puzzles.size()] = puzzle;
+            ring.size++;
+            ring.stats.generated++;
+            // sum of times, getStats turns it into the average
+            ring.stats.generateSeconds += seconds;
+
+            ready.notify_all();
+        }
+    }
+}
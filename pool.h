@@ -0,0 +1,89 @@
+#pragma once
+#include "sudoku.h"
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+
+namespace Sudoku
+{
+    // puzzles of generateSudokuWithDifficulty(spaces, minDifficulty, maxDifficulty)
+    struct PoolBand
+    {
+        size_t spaces = 55;
+        size_t minDifficulty = 90;
+        size_t maxDifficulty = 100;
+        // ready puzzles kept in the pool
+        size_t capacity = 16;
+    };
+
+    struct PoolPuzzle
+    {
+        Board board{};
+        Board solution{};
+        size_t difficulty = 0;
+    };
+
+    struct PoolBandStats
+    {
+        PoolBand band;
+        // ready puzzles
+        size_t size = 0;
+        size_t generated = 0;
+        size_t served = 0;
+        // requests which found no ready puzzle
+        size_t misses = 0;
+        // generated puzzles per second since the pool was started
+        double refillRate = 0.0;
+        // average time one worker spends on a puzzle of the band
+        double generateSeconds = 0.0;
+    };
+
+    // ready puzzles of several bands, background workers keep each band full and refill the emptiest one first
+    // (bands which can't be reached for their spaces keep workers busy until the pool stops)
+    struct PuzzlePool
+    {
+        using Clock = std::chrono::steady_clock;
+
+        // ring buffer of one band
+        struct Ring
+        {
+            std::vector<PoolPuzzle> puzzles;
+            size_t head = 0;
+            size_t size = 0;
+            // puzzles being generated by workers
+            size_t pending = 0;
+            PoolBandStats stats;
+        };
+
+        // threads 0 means all cores
+        PuzzlePool(const std::vector<PoolBand>& bands, size_t threads);
+        // cancels puzzles which workers are generating and waits for them
+        ~PuzzlePool();
+
+        PuzzlePool(const PuzzlePool&) = delete;
+        PuzzlePool& operator=(const PuzzlePool&) = delete;
+
+        size_t bandsCount() const;
+        // oldest ready puzzle of the band, if there is none waits for it when wait is true, otherwise returns none
+        std::optional<PoolPuzzle> take(size_t band, bool wait);
+        std::vector<PoolBandStats> getStats();
+
+        // band which has least ready and pending puzzles and isn't full, bandsCount() if all are full
+        size_t emptiestBand() const;
+        void work();
+
+        std::vector<Ring> rings;
+        std::vector<std::thread> workers;
+        Clock::time_point start;
+        bool stopping = false;
+        // stops generation in progress when the pool stops
+        Cancellation stop;
+
+        std::mutex mutex;
+        // notified when a puzzle is taken or the pool stops
+        std::condition_variable refill;
+        // notified when a puzzle is ready or the pool stops
+        std::condition_variable ready;
+    };
+}
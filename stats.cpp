@@ -0,0 +1,173 @@
+#include "stats.h"
+#include <mutex>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+
+namespace Sudoku
+{
+    static const char* COUNTER_NAMES[COUNTERS_COUNT] =
+    {
+        "solverNodes",
+        "backtracks",
+        "uniquenessChecks",
+        "rejectedRemovals",
+        "boardRestarts",
+        "regenerations",
+        "hillClimbSteps",
+        "hillClimbRestarts",
+        "changeSpaceRetries",
+    };
+
+    static const char* PHASE_NAMES[PHASES_COUNT] =
+    {
+        "prepareBoard",
+        "removeSpaces",
+        "changeSpace",
+        "computeDifficulty",
+    };
+
+    const char* getCounterName(Counter counter)
+    {
+        return COUNTER_NAMES[static_cast<size_t>(counter)];
+    }
+
+    const char* getPhaseName(Phase phase)
+    {
+        return PHASE_NAMES[static_cast<size_t>(phase)];
+    }
+
+    Stats& Stats::operator+=(const Stats& other)
+    {
+        for (size_t i = 0; i < COUNTERS_COUNT; ++i)
+            counters[i] += other.counters[i];
+
+        for (size_t i = 0; i < PHASES_COUNT; ++i)
+        {
+            phases[i].calls += other.phases[i].calls;
+            phases[i].nanoseconds += other.phases[i].nanoseconds;
+        }
+
+        return *this;
+    }
+
+    std::string statsToJson(const Stats& stats)
+    {
+        std::ostringstream result;
+
+        result << "{\"counters\":{";
+        for (size_t i = 0; i < COUNTERS_COUNT; ++i)
+            result << (i ? "," : "") << "\"" << COUNTER_NAMES[i] << "\":" << stats.counters[i];
+
+        result << "},\"phases\":{";
+        for (size_t i = 0; i < PHASES_COUNT; ++i)
+        {
+            result << (i ? "," : "") << "\"" << PHASE_NAMES[i] << "\":{\"calls\":" << stats.phases[i].calls
+                << ",\"seconds\":" << stats.phases[i].nanoseconds * 1e-9 << "}";
+        }
+        result << "}}";
+
+        return result.str();
+    }
+
+#ifdef SUDOKU_STATS
+    // live threads and sum of the finished ones
+    struct StatsRegistry
+    {
+        std::mutex mutex;
+        std::vector<ThreadStats*> threads;
+        Stats finished;
+    };
+
+    StatsRegistry& getRegistry()
+    {
+        // never destroyed, threads may exit after static destructors ran
+        static StatsRegistry* registry = new StatsRegistry();
+        return *registry;
+    }
+
+    ThreadStats::ThreadStats()
+    {
+        auto& registry = getRegistry();
+        std::lock_guard lock(registry.mutex);
+        registry.threads.push_back(this);
+    }
+
+    ThreadStats::~ThreadStats()
+    {
+        auto& registry = getRegistry();
+        std::lock_guard lock(registry.mutex);
+        registry.threads.erase(std::find(registry.threads.begin(), registry.threads.end(), this));
+        registry.finished += get();
+    }
+
+    Stats ThreadStats::get() const
+    {
+        Stats result;
+
+        for (size_t i = 0; i < COUNTERS_COUNT; ++i)
+            result.counters[i] = counters[i].load(std::memory_order_relaxed);
+
+        for (size_t i = 0; i < PHASES_COUNT; ++i)
+        {
+            result.phases[i].calls = phaseCalls[i].load(std::memory_order_relaxed);
+            result.phases[i].nanoseconds = phaseNanoseconds[i].load(std::memory_order_relaxed);
+        }
+
+        return result;
+    }
+
+    void ThreadStats::reset()
+    {
+        for (auto& counter : counters)
+            counter.store(0, std::memory_order_relaxed);
+
+        for (size_t i = 0; i < PHASES_COUNT; ++i)
+        {
+            phaseCalls[i].store(0, std::memory_order_relaxed);
+            phaseNanoseconds[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    Stats getThreadStats()
+    {
+        return g_threadStats.get();
+    }
+
+    Stats getStats()
+    {
+        auto& registry = getRegistry();
+        std::lock_guard lock(registry.mutex);
+
+        Stats result = registry.finished;
+        for (auto thread : registry.threads)
+            result += thread->get();
+
+        return result;
+    }
+
+    void resetStats()
+    {
+        auto& registry = getRegistry();
+        std::lock_guard lock(registry.mutex);
+
+        registry.finished = Stats();
+        for (auto thread : registry.threads)
+            thread->reset();
+    }
+#else
+    Stats getThreadStats()
+    {
+        return {};
+    }
+
+    Stats getStats()
+    {
+        return {};
+    }
+
+    void resetStats()
+    {
+    }
+#endif
+}
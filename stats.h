@@ -0,0 +1,125 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// instrumentation of the generator and the solvers, compiled in only if SUDOKU_STATS is defined
+// (cmake -DSUDOKU_STATS=ON), otherwise counting and timing macros expand to nothing and all stats are 0
+
+namespace Sudoku
+{
+#ifdef SUDOKU_STATS
+    static const bool STATS_ENABLED = true;
+#else
+    static const bool STATS_ENABLED = false;
+#endif
+
+    enum class Counter
+    {
+        SolverNodes, // calls of the recursive search of any solver
+        Backtracks, // numbers taken back because their subtree has no (more) solutions
+        UniquenessChecks, // countSolutions calls and searches for another solution, the generator uses them only to check uniqueness
+        RejectedRemovals, // numbers removeSpaces had to put back because the solution wasn't (proved) unique anymore
+        BoardRestarts, // generateGrid restarts after the random search gave up
+        Regenerations, // generateSudoku restarts after removeSpaces failed
+        HillClimbSteps, // changes of generateSudokuWithDifficulty towards the difficulty band
+        HillClimbRestarts, // generateSudokuWithDifficulty restarts with a new puzzle after steps ran out
+        ChangeSpaceRetries, // changes of the difficulty search dropped because the solution wasn't unique
+    };
+    static const size_t COUNTERS_COUNT = 9;
+
+    enum class Phase
+    {
+        PrepareBoard, // generateGrid
+        RemoveSpaces, // removeSpaces
+        ChangeSpace, // changeSpace
+        ComputeDifficulty, // computeDifficulty
+    };
+    static const size_t PHASES_COUNT = 4;
+
+    struct PhaseStats
+    {
+        uint64_t calls = 0;
+        uint64_t nanoseconds = 0;
+    };
+
+    struct Stats
+    {
+        std::array<uint64_t, COUNTERS_COUNT> counters{};
+        std::array<PhaseStats, PHASES_COUNT> phases{};
+
+        uint64_t operator[](Counter counter) const
+        {
+            return counters[static_cast<size_t>(counter)];
+        }
+
+        const PhaseStats& operator[](Phase phase) const
+        {
+            return phases[static_cast<size_t>(phase)];
+        }
+
+        Stats& operator+=(const Stats& other);
+    };
+
+    // names used in json, e.g. solverNodes
+    const char* getCounterName(Counter counter);
+    const char* getPhaseName(Phase phase);
+
+    // stats of the calling thread
+    Stats getThreadStats();
+    // sum of stats of all threads, including finished ones
+    Stats getStats();
+    // should be called when no other thread is generating or solving, their counts could be lost otherwise
+    void resetStats();
+    // {"counters":{"solverNodes":1,...},"phases":{"prepareBoard":{"calls":1,"seconds":0.1},...}}
+    std::string statsToJson(const Stats& stats);
+
+#ifdef SUDOKU_STATS
+    // counters of one thread, they are written only by the owner, so relaxed loads and stores are enough
+    // to let other threads read them (no atomic read-modify-write is needed on the hot path)
+    struct ThreadStats
+    {
+        std::array<std::atomic<uint64_t>, COUNTERS_COUNT> counters{};
+        std::array<std::atomic<uint64_t>, PHASES_COUNT> phaseCalls{};
+        std::array<std::atomic<uint64_t>, PHASES_COUNT> phaseNanoseconds{};
+
+        // registers the thread, so getStats can see its counters, and adds them to finished ones at exit
+        ThreadStats();
+        ~ThreadStats();
+
+        Stats get() const;
+        void reset();
+    };
+
+    inline thread_local ThreadStats g_threadStats;
+
+    inline void addStat(std::atomic<uint64_t>& value, uint64_t count)
+    {
+        value.store(value.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    }
+
+    // measures time from its construction to its destruction
+    struct PhaseTimer
+    {
+        Phase phase;
+        std::chrono::steady_clock::time_point start;
+
+        explicit PhaseTimer(Phase p) : phase(p), start(std::chrono::steady_clock::now()) {}
+
+        ~PhaseTimer()
+        {
+            auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            addStat(g_threadStats.phaseCalls[static_cast<size_t>(phase)], 1);
+            addStat(g_threadStats.phaseNanoseconds[static_cast<size_t>(phase)], static_cast<uint64_t>(nanoseconds));
+        }
+    };
+
+#define SUDOKU_COUNT(counter) ::Sudoku::addStat(::Sudoku::g_threadStats.counters[static_cast<size_t>(::Sudoku::Counter::counter)], 1)
+#define SUDOKU_TIME_PHASE(phase) ::Sudoku::PhaseTimer phaseTimer(::Sudoku::Phase::phase)
+#else
+#define SUDOKU_COUNT(counter) ((void)0)
+#define SUDOKU_TIME_PHASE(phase) ((void)0)
+#endif
+}
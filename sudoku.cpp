@@ -1,18 +1,24 @@
 #include "sudoku.h"
+#include "candidates.h"
+#include "dlx.h"
+#include "stats.h"
 #include <random>
 #include <algorithm>
 #include <iostream>
 #include <iomanip>
 #include <cassert>
-#include <set>
-#include <map>
+#include <bit>
+#include <limits>
+#include <atomic>
+#include <thread>
+#include <barrier>
+#include <cmath>
+#include <memory>
 
 namespace Sudoku
 {
-    static const size_t NUMBERS_COUNT = BOARD_SIZE + 1; // +1 here because 0 is valid number (empty)
-
-    std::random_device g_rd;
-    std::mt19937 g_mt(g_rd());
+    // generator used by overloads which don't take one, each thread has its own
+    thread_local Generator g_generator;
 
     struct RowCol
     {
@@ -22,13 +28,6 @@ namespace Sudoku
         RowCol() {}
         RowCol(size_t r, size_t c) : row(r), col(c) {}
 
-        RowCol next()
-        {
-            if (col + 1 >= BOARD_SIZE)
-                return { row + 1, 0 };
-            return { row, col + 1 };
-        }
-
         friend bool operator<(const RowCol& l, const RowCol& r) noexcept
         {
             return l.row == r.row ? l.col < r.col : l.row < r.row;
@@ -40,7 +39,60 @@ namespace Sudoku
         }
     };
 
-    void printBoard(const Board& board)
+    uint64_t splitMix64(uint64_t& x)
+    {
+        uint64_t z = (x += 0x9e3779b97f4a7c15);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+
+    Generator::Generator() : Generator(std::random_device{}() | (uint64_t(std::random_device{}()) << 32))
+    {
+    }
+
+    Generator::Generator(uint64_t s) : seed(s)
+    {
+        // xoshiro state must not be all zeros, splitmix64 expansion guarantees that
+        uint64_t x = seed;
+        for (auto& value : state)
+            value = splitMix64(x);
+    }
+
+    Generator::result_type Generator::operator()()
+    {
+        // xoshiro256**
+        uint64_t result = std::rotl(state[1] * 5, 7) * 9;
+        uint64_t t = state[1] << 17;
+
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = std::rotl(state[3], 45);
+
+        return result;
+    }
+
+    // uniform random number in [0, count), same results on all platforms for the same seed
+    // (unlike std distributions), Lemire's multiply and reject method
+    size_t random(Generator& generator, size_t count)
+    {
+        assert(count > 0 && count <= std::numeric_limits<uint32_t>::max());
+
+        uint32_t range = static_cast<uint32_t>(count);
+        uint32_t threshold = (0 - range) % range;
+        while (true)
+        {
+            uint64_t m = (generator() >> 32) * range;
+            if (static_cast<uint32_t>(m) >= threshold)
+                return static_cast<size_t>(m >> 32);
+        }
+    }
+
+    template<class G>
+    void printBoard(const typename G::Board& board)
     {
         for (size_t r = 0; r < board.size(); ++r)
         {
@@ -53,662 +105,1911 @@ namespace Sudoku
         std::cout << "\n";
     }
 
-    Candidates getCandidatesArray(const Board& board, size_t row, size_t col)
+    template<class G>
+    std::vector<uint8_t> getCandidates(const typename G::Board& board, size_t row, size_t column)
     {
-        Candidates candidates;
-        std::fill(std::begin(candidates), std::end(candidates), true);
+        using Candidates = typename G::Candidates;
 
-        // check the row
-        for (size_t i = 0; i < BOARD_SIZE; ++i)
-            candidates[board[row][i]] = false;
+        Candidates used = 0;
+        for (size_t i = 0; i < G::BOARD_SIZE; ++i)
+            used |= numberBit<Candidates>(board[row][i]) | numberBit<Candidates>(board[i][column]);
 
-        // check the column
-        for (size_t i = 0; i < BOARD_SIZE; ++i)
-            candidates[board[i][col]] = false;
+        size_t rowStart = (row / G::GRID_ROWS) * G::GRID_ROWS;
+        size_t colStart = (column / G::GRID_COLS) * G::GRID_COLS;
+        for (size_t r = rowStart; r < rowStart + G::GRID_ROWS; ++r)
+            for (size_t c = colStart; c < colStart + G::GRID_COLS; ++c)
+                used |= numberBit<Candidates>(board[r][c]);
 
-        // check the grid
-        size_t rowStart = (row / GRID_COUNT) * GRID_COUNT;
-        size_t colStart = (col / GRID_COUNT) * GRID_COUNT;
-        for (size_t r = rowStart; r < rowStart + GRID_COUNT; ++r)
-        {
-            for (size_t c = colStart; c < colStart + GRID_COUNT; ++c)
-            {
-                candidates[board[r][c]] = false;
-            }
-        }
+        std::vector<uint8_t> result;
+        result.reserve(G::BOARD_SIZE);
+
+        for (Candidates candidates = G::ALL_CANDIDATES & ~used; candidates; candidates &= candidates - 1)
+            result.push_back(firstCandidate(candidates));
 
-        return candidates;
+        return result;
     }
 
-    std::vector<uint8_t> getCandidates(const Board& board, size_t row, size_t column)
+    // state of the backtracking search, candidates of empty cells are kept up to date
+    // incrementally (placing number touches only peers of the cell, backtracking restores them)
+    template<class G>
+    struct SearchState
     {
-        auto candidates = getCandidatesArray(board, row, column);
+        using Board = typename G::Board;
+        using Candidates = typename G::Candidates;
 
-        // omit the 0 as candidate
-        std::vector<uint8_t> result;
-        result.reserve(BOARD_SIZE);
+        Board& board;
+        std::array<Candidates, G::CELLS_COUNT> candidates{};
+
+        // empty cells are kept in [0, emptyCount), filled ones are moved behind
+        Cells<G> empty;
+        size_t emptyCount = 0;
+
+        // false if some number on the board conflicts with another one
+        // or if there is empty cell without candidates
+        bool valid = true;
 
-        for (size_t i = 1; i < candidates.size(); ++i)
+        // candidates of empty cells are already known and the board is valid
+        SearchState(Board& b, const std::array<Candidates, G::CELLS_COUNT>& c) : board(b), candidates(c)
         {
-            if (candidates[i])
-                result.push_back(static_cast<uint8_t>(i));
+            for (size_t cell = 0; cell < G::CELLS_COUNT; ++cell)
+                if (isEmpty(cell))
+                    empty[emptyCount++] = static_cast<typename G::Cell>(cell);
         }
 
-        return result;
-    }
+        SearchState(Board& b) : board(b)
+        {
+            BoardMasks<G> masks;
 
-    void applyConstraints(const Board* constraints, size_t row, size_t col, Candidates& candidates)
-    {
-        if (!constraints || row > BOARD_SIZE || col > BOARD_SIZE)
-            return;
+            for (size_t r = 0; r < G::BOARD_SIZE; ++r)
+            {
+                for (size_t c = 0; c < G::BOARD_SIZE; ++c)
+                {
+                    if (board[r][c] == 0)
+                        continue;
+
+                    if (!(masks.candidates(r, c) & numberBit<Candidates>(board[r][c])))
+                        valid = false;
+                    masks.set(r, c, board[r][c]);
+                }
+            }
 
-        if (constraints->at(row)[col] == 0)
-            return;
+            BoardScan<G> scan;
+            scanBoard(board, masks, scan);
 
-        candidates[constraints->at(row)[col]] = false;
-    }
+            candidates = scan.candidates;
+            scan.empty.forEach([this](size_t cell) { empty[emptyCount++] = static_cast<typename G::Cell>(cell); });
 
-    std::tuple<RowCol, Candidates> getLeastCandidates(const Board& board)
-    {
-        RowCol result(BOARD_SIZE + 1, BOARD_SIZE + 1);
-        size_t resultCandidatesCount = std::numeric_limits<size_t>::max();
-        Candidates resultCandidates;;
+            // some cell has no candidates already
+            if (scan.leastCandidatesCell < G::CELLS_COUNT && !candidates[scan.leastCandidatesCell])
+                valid = false;
+        }
 
-        for (size_t r = 0; r < BOARD_SIZE; r++)
+        // index into empty of the cell with least candidates
+        size_t getLeastCandidates() const
         {
-            for (size_t c = 0; c < BOARD_SIZE; c++)
-            {
-                if (board[r][c] != 0)
-                    continue;
+            size_t result = 0;
+            size_t resultCandidatesCount = std::numeric_limits<size_t>::max();
 
-                auto candidates = getCandidatesArray(board, r, c);
-                size_t count = 0;
-                for (size_t i = 1; i < candidates.size(); i++)
-                {
-                    if (candidates[i])
-                        count++;
-                }
+            for (size_t i = 0; i < emptyCount; ++i)
+            {
+                size_t count = countCandidates(candidates[empty[i]]);
                 if (count < resultCandidatesCount)
                 {
-                    resultCandidates = candidates;
+                    result = i;
                     resultCandidatesCount = count;
-                    result = { r, c };
+
+                    // can't do better than this
+                    if (count <= 1)
+                        break;
                 }
             }
+
+            return result;
         }
 
-        return { result, resultCandidates };
-    }
+        // remove cell from the empty cells, must be reverted by restore in reverse order
+        size_t take(size_t index)
+        {
+            std::swap(empty[index], empty[--emptyCount]);
+            return empty[emptyCount];
+        }
+
+        void restore()
+        {
+            emptyCount++;
+        }
 
-    bool solveRandomBoardRecursive(Board& board, RowCol rowCol, const Candidates& candidates, const Board* constraints)
+        bool isEmpty(size_t cell) const
+        {
+            return board[cell / G::BOARD_SIZE][cell % G::BOARD_SIZE] == 0;
+        }
+
+        // fill the cell and remove the number from candidates of its peers,
+        // changed peers are stored in removed and count of them in removedCount
+        // returns false if some empty peer is left without candidates (must be unplaced anyway)
+        bool place(size_t cell, uint8_t number, PeerCells<G>& removed, size_t& removedCount)
+        {
+            board[cell / G::BOARD_SIZE][cell % G::BOARD_SIZE] = number;
+
+            Candidates bit = numberBit<Candidates>(number);
+            bool result = true;
+            removedCount = 0;
+            for (auto peer : g_peers<G>[cell])
+            {
+                if (candidates[peer] & bit)
+                {
+                    candidates[peer] &= ~bit;
+                    removed[removedCount++] = peer;
+
+                    if (!candidates[peer] && isEmpty(peer))
+                        result = false;
+                }
+            }
+
+            return result;
+        }
+
+        void unplace(size_t cell, uint8_t number, const PeerCells<G>& removed, size_t count)
+        {
+            Candidates bit = numberBit<Candidates>(number);
+            for (size_t i = 0; i < count; ++i)
+                candidates[removed[i]] |= bit;
+
+            board[cell / G::BOARD_SIZE][cell % G::BOARD_SIZE] = 0;
+        }
+    };
+
+    // numbers are tried in random order if generator is given,
+    // failures is count of wrong guesses left, search gives up when it reaches 0
+    template<class G>
+    bool solveRandomBoardRecursive(SearchState<G>& state, Generator* generator, size_t& failures)
     {
+        SUDOKU_COUNT(SolverNodes);
+
         // no more empty cells, solved
-        auto [row, col] = rowCol;
-        if (row >= BOARD_SIZE)
+        if (state.emptyCount == 0)
         {
             return true;
         }
 
-        assert(board[row][col] == 0);
+        if (isSearchCancelled())
+            return false;
 
-        for (uint8_t number = 1; number <= BOARD_SIZE; number++)
-        {
-            // here we are checking candidates, if we find cell with no candidates, there is no solution
-            if (!candidates[number])
-                continue;
+        size_t cell = state.take(state.getLeastCandidates());
 
-            board[row][col] = number;
+        std::array<uint8_t, G::BOARD_SIZE> numbers;
+        size_t numbersCount = 0;
+        for (auto candidates = state.candidates[cell]; candidates; candidates &= candidates - 1)
+            numbers[numbersCount++] = firstCandidate(candidates);
+
+        if (generator)
+            shuffle(numbers.begin(), numbers.begin() + numbersCount, *generator);
+
+        // if we find cell with no candidates, there is no solution
+        for (size_t i = 0; i < numbersCount; ++i)
+        {
+            uint8_t number = numbers[i];
 
-            auto [nextCell, nextCandidates] = getLeastCandidates(board);
-            applyConstraints(constraints, nextCell.row, nextCell.col, nextCandidates);
+            PeerCells<G> removed;
+            size_t removedCount;
 
-            if (solveRandomBoardRecursive(board, nextCell, nextCandidates, constraints))
+            if (state.place(cell, number, removed, removedCount) && solveRandomBoardRecursive(state, generator, failures))
                 return true;
 
             // this is important (:
-            board[row][col] = 0;
+            state.unplace(cell, number, removed, removedCount);
+            SUDOKU_COUNT(Backtracks);
+
+            if (failures == 0)
+                break;
+            failures--;
         }
 
+        state.restore();
+
         return false;
     }
 
-    std::optional<Board> solveRandomBoard(const Board& board, const Board* constraints = nullptr)
+    template<class G>
+    size_t countSolutionsRecursive(SearchState<G>& state, size_t limit, std::vector<typename G::Board>* solutions)
     {
-        Board tmp = board;
-        auto [nextCell, nextCandidates] = getLeastCandidates(board);
-        applyConstraints(constraints, nextCell.row, nextCell.col, nextCandidates);
+        SUDOKU_COUNT(SolverNodes);
 
-        if (solveRandomBoardRecursive(tmp, nextCell, nextCandidates, constraints))
-            return tmp;
+        if (state.emptyCount == 0)
+        {
+            if (solutions)
+                solutions->push_back(state.board);
+            return 1;
+        }
 
-        return {};
-    }
+        if (isSearchCancelled())
+            return 0;
 
-    Board prepareRandomBoard()
-    {
-        Board board{};
+        size_t cell = state.take(state.getLeastCandidates());
+        size_t count = 0;
 
-        // initialize diagonal grids which are indenpendent
-        for (size_t start = 0; start < GRID_COUNT; ++start)
+        for (auto candidates = state.candidates[cell]; candidates && count < limit; candidates &= candidates - 1)
         {
-            std::array<uint8_t, BOARD_SIZE> array;
-            for (uint8_t v = 0; v < BOARD_SIZE; ++v)
-                array[v] = v;
-            std::shuffle(std::begin(array), std::end(array), g_mt);
+            uint8_t number = firstCandidate(candidates);
 
-            size_t rowStart = GRID_COUNT * start, colStart = GRID_COUNT * start, counter = 0;
-            for (size_t r = rowStart; r < rowStart + GRID_COUNT; ++r)
-            {
-                for (size_t c = colStart; c < colStart + GRID_COUNT; ++c)
-                {
-                    board[r][c] = array[counter++];
-                }
-            }
+            PeerCells<G> removed;
+            size_t removedCount;
+
+            size_t found = 0;
+            if (state.place(cell, number, removed, removedCount))
+                found = countSolutionsRecursive(state, limit - count, solutions);
+            count += found;
+
+            // this is important (:
+            state.unplace(cell, number, removed, removedCount);
+            if (found == 0)
+                SUDOKU_COUNT(Backtracks);
         }
 
-        // find first random solution
-        return *solveRandomBoard(board);
+        state.restore();
+
+        return count;
     }
 
-    size_t getSolutionsInternal(Board& board, std::vector<Board>* solutions = nullptr, RowCol rowCol = {})
+    template<class G>
+    struct BacktrackingSolver : BasicSolver<G>
     {
-        auto [row, col] = rowCol;
-        if (row >= BOARD_SIZE)
+        using Board = typename G::Board;
+
+        std::optional<Board> solve(const Board& board, Generator* generator, size_t maxFailures)
         {
-            if (solutions)
-                solutions->push_back(board);
-            return 1;
+            Board tmp = board;
+            SearchState<G> state(tmp);
+
+            if (state.valid && solveRandomBoardRecursive(state, generator, maxFailures))
+                return tmp;
+
+            return {};
         }
 
-        if (board[row][col] != 0)
+        std::optional<Board> solve(const Board& board) override
         {
-            return getSolutionsInternal(board, solutions, rowCol.next());
+            return solve(board, nullptr, std::numeric_limits<size_t>::max());
         }
 
-        auto candidates = getCandidates(board, row, col);
-        size_t count = 0;
+        std::optional<Board> solveRandom(const Board& board, Generator& generator, size_t maxFailures) override
+        {
+            return solve(board, &generator, maxFailures);
+        }
 
-        for (auto candidate : candidates)
+        size_t countSolutions(const Board& board, size_t limit, std::vector<Board>* solutions) override
         {
-            board[row][col] = candidate;
+            Board tmp = board;
+            SearchState<G> state(tmp);
 
-            count += getSolutionsInternal(board, solutions, rowCol.next());
+            if (!state.valid || limit == 0)
+                return 0;
 
-            // this is important (:
-            board[row][col] = 0;
+            return countSolutionsRecursive(state, limit, solutions);
         }
+    };
 
-        return count;
-    }
+    std::atomic<SolverBackend> g_solverBackend = SolverBackend::Backtracking;
 
-    size_t getSolutions(Board& board, std::vector<Board>& solutions)
+    template<class G>
+    BasicSolver<G>& getSolver(SolverBackend backend)
     {
-        return getSolutionsInternal(board, &solutions);
+        // dancing links keep their links between calls, so each thread has its own solvers
+        // (created on the first use, the links are big for big boards)
+        if (backend == SolverBackend::DancingLinks)
+        {
+            thread_local DancingLinksSolver<G> dancingLinks;
+            return dancingLinks;
+        }
+
+        thread_local BacktrackingSolver<G> backtracking;
+        return backtracking;
     }
 
-    std::vector<RowCol> initializeSpaceCandidates()
+    void setSolverBackend(SolverBackend backend)
     {
-        std::vector<RowCol> result;
-        result.reserve(BOARD_SIZE * BOARD_SIZE);
-
-        for (size_t r = 0; r < BOARD_SIZE; ++r)
-            for (size_t c = 0; c < BOARD_SIZE; ++c)
-                result.push_back({ r, c });
-
-        return result;
+        g_solverBackend.store(backend, std::memory_order_relaxed);
     }
 
-    RowCol acquireRandomSpaceCandidate(std::vector<RowCol>& candidates)
+    SolverBackend getSolverBackend()
     {
-        std::uniform_int_distribution<size_t> rand(0, candidates.size() - 1);
-        
-        auto it = std::begin(candidates);
-        std::advance(it, rand(g_mt));
-        
-        auto res = *it;
-        candidates.erase(it);
-        
-        return res;
+        return g_solverBackend.load(std::memory_order_relaxed);
     }
 
-    std::vector<RowCol> getEmptyCells(const Board& board)
+    template<class G>
+    std::optional<typename G::Board> solveRandomBoard(const typename G::Board& board)
     {
-        std::vector<RowCol> result;
-        for (size_t r = 0; r < BOARD_SIZE; ++r)
-            for (size_t c = 0; c < BOARD_SIZE; ++c)
-                if (board[r][c] == 0)
-                    result.push_back({ r, c });
-        return result;
+        return getSolver<G>(getSolverBackend()).solve(board);
     }
 
-    void updateCandidatesAndEmptyCells(const Board& board, size_t filledIndex, std::vector<RowCol>& emptyCells, std::vector<std::vector<uint8_t>>& candidates)
+    // fills cells in row-major order, each with a random number allowed by the masks of its row, column and grid
+    // (no cell is chosen and no candidates are kept, so a node costs a few instructions)
+    template<class G>
+    struct GridFiller
     {
-        for (size_t i = 0; i < emptyCells.size(); i++)
-        {
-            if (i == filledIndex)
-                continue;
+        using Candidates = typename G::Candidates;
 
-            candidates[i] = getCandidates(board, emptyCells[i].row, emptyCells[i].col);
-        }
+        typename G::Board board{};
+        BoardMasks<G> masks;
+        // nodes left before the search gives up
+        size_t budget = 0;
 
-        emptyCells.erase(std::begin(emptyCells) + filledIndex);
-        candidates.erase(std::begin(candidates) + filledIndex);
-    }
+        void set(size_t r, size_t c, uint8_t number)
+        {
+            board[r][c] = number;
+            masks.set(r, c, number);
+        }
 
-    std::vector<size_t> getIndicesWithSingleCandidate(const std::vector<RowCol>& cells, const std::vector<std::vector<uint8_t>>& candidates)
-    {
-        std::vector<size_t> result;
-        for (size_t i = 0; i < cells.size(); i++)
+        void clear(size_t r, size_t c)
         {
-            if (candidates[i].size() == 1)
-                result.push_back(i);
+            masks.clear(r, c, board[r][c]);
+            board[r][c] = 0;
         }
-        return result;
-    }
 
-    size_t getCellIndexWithLeastCandidates(const std::vector<RowCol>& cells, const std::vector<std::vector<uint8_t>>& candidates)
-    {
-        size_t minCount = std::numeric_limits<size_t>::max();
-        size_t result = -1;
-        for (size_t i = 0; i < cells.size(); i++)
+        bool fill(size_t cell, Generator& generator)
         {
-            if (candidates[i].size() < minCount)
+            if (cell == G::CELLS_COUNT)
+                return true;
+
+            size_t r = cell / G::BOARD_SIZE, c = cell % G::BOARD_SIZE;
+            auto candidates = static_cast<Candidates>(masks.candidates(r, c));
+
+            while (candidates && budget)
             {
-                result = i;
-                minCount = candidates[i].size();
+                budget--;
+
+                // random candidate, the last one needs no random number
+                auto pick = candidates;
+                size_t count = countCandidates(candidates);
+                for (size_t skip = count > 1 ? random(generator, count) : 0; skip; --skip)
+                    pick &= pick - 1;
+                uint8_t number = firstCandidate(pick);
+                candidates &= static_cast<Candidates>(~numberBit<Candidates>(number));
+
+                set(r, c, number);
+                if (fill(cell + 1, generator))
+                    return true;
+                clear(r, c);
+                SUDOKU_COUNT(Backtracks);
             }
+
+            return false;
         }
-        return result;
-    }
+    };
 
-    size_t computeDifficulty(const Board& solution, const Board& board)
+    // random permutation of bands, rows within bands, stacks, columns within stacks and transposition
+    // (if grids are square), the filler prefers some arrangements of a grid, this makes them equally likely
+    template<class G>
+    typename G::Board shuffleArrangement(const typename G::Board& board, Generator& generator)
     {
-        std::vector<RowCol> emptyCells = getEmptyCells(board);
-        std::vector<std::vector<uint8_t>> candidates;
-
-        size_t numberOfEmptyCells = emptyCells.size();
-        size_t singleCellCandidates = 0;
-
-        for (const auto& cell : emptyCells)
-            candidates.push_back(getCandidates(board, cell.row, cell.col));
-
-        Board tmpBoard = board;
-        while (emptyCells.size())
+        // lines come in groups of lineGroup lines
+        auto permuteLines = [&](size_t lineGroup)
         {
-            size_t cellIndex;
+            std::array<uint8_t, G::BOARD_SIZE> lines, groups, inGroup;
+            size_t groupsCount = G::BOARD_SIZE / lineGroup;
 
-            auto singleCandidates = getIndicesWithSingleCandidate(emptyCells, candidates);
-            singleCellCandidates += singleCandidates.size();
+            for (uint8_t i = 0; i < G::BOARD_SIZE; ++i)
+                groups[i] = inGroup[i] = i;
+            shuffle(groups.begin(), groups.begin() + groupsCount, generator);
 
-            if (singleCandidates.empty())
-            {
-                cellIndex = getCellIndexWithLeastCandidates(emptyCells, candidates);
-            }
-            else
+            for (size_t group = 0; group < groupsCount; ++group)
             {
-                cellIndex = singleCandidates[0];
+                shuffle(inGroup.begin(), inGroup.begin() + lineGroup, generator);
+                for (size_t line = 0; line < lineGroup; ++line)
+                    lines[group * lineGroup + line] = static_cast<uint8_t>(groups[group] * lineGroup + inGroup[line]);
             }
 
-            auto cell = emptyCells[cellIndex];
-            tmpBoard[cell.row][cell.col] = solution[cell.row][cell.col];
+            return lines;
+        };
 
-            updateCandidatesAndEmptyCells(tmpBoard, cellIndex, emptyCells, candidates);
-        }
+        auto rows = permuteLines(G::GRID_ROWS);
+        auto cols = permuteLines(G::GRID_COLS);
+        bool transpose = G::GRID_ROWS == G::GRID_COLS && random(generator, 2);
 
-        return singleCellCandidates;
+        typename G::Board result;
+        for (size_t r = 0; r < G::BOARD_SIZE; ++r)
+            for (size_t c = 0; c < G::BOARD_SIZE; ++c)
+                result[r][c] = transpose ? board[cols[c]][rows[r]] : board[rows[r]][cols[c]];
+
+        return result;
     }
 
-    bool removeSpaces(Board& board, size_t spaces)
+    template<class G>
+    typename G::Board generateGrid(Generator& generator)
     {
-        Board solution = board;
+        SUDOKU_TIME_PHASE(PrepareBoard);
 
-        // create vector of candidates for spaces
-        auto spaceCandidates = initializeSpaceCandidates();
-        Board constraints{};
-
-        size_t currentSpaces = 0;
-        while (currentSpaces < spaces)
+        // the filler gets lost in wrong rows on big boards, the solver chooses the cell with least candidates
+        if constexpr (G::BOARD_SIZE <= 16)
         {
-            if (spaceCandidates.empty())
+            // nodes of one attempt, most grids need fewer than 2 * CELLS_COUNT
+            static const size_t MaxNodes = 5 * G::CELLS_COUNT;
+
+            while (true)
             {
-                // we are not able to create board with spaces
-                return false;
+                GridFiller<G> filler;
+                filler.budget = MaxNodes;
+
+                // any first row is possible, the filler treats all numbers the same, so numbers are uniform
+                std::array<uint8_t, G::BOARD_SIZE> first;
+                for (uint8_t i = 0; i < G::BOARD_SIZE; ++i)
+                    first[i] = i + 1;
+                shuffle(first.begin(), first.end(), generator);
+                for (size_t c = 0; c < G::BOARD_SIZE; ++c)
+                    filler.set(0, c, first[c]);
+
+                if (filler.fill(G::BOARD_SIZE, generator))
+                    return shuffleArrangement<G>(filler.board, generator);
+                if (isCallCancelled())
+                    return filler.board;
+
+                SUDOKU_COUNT(BoardRestarts);
             }
+        }
+        else
+        {
+            // random search sometimes gets lost in a subtree without solution,
+            // it is faster to give up and start again with other diagonal grids
+            static const size_t MaxFailures = 4 * G::CELLS_COUNT;
 
-            auto [row, col] = acquireRandomSpaceCandidate(spaceCandidates);
-
-            constraints[row][col] = board[row][col];
-            board[row][col] = 0;
+            auto& solver = getSolver<G>(getSolverBackend());
 
-            // if we solve the board with the constraint, we have introduced
-            // another solution
-            if (solveRandomBoard(board, &constraints))
-            {
-                // revert back
-                board[row][col] = constraints[row][col];
-            }
-            else
+            while (true)
             {
-                currentSpaces++;
-            }
+                typename G::Board board{};
+
+                // initialize diagonal grids which are indenpendent
+                for (size_t start = 0; start < std::min(G::GRID_ROWS, G::GRID_COLS); ++start)
+                {
+                    std::array<uint8_t, G::BOARD_SIZE> array;
+                    for (uint8_t v = 0; v < G::BOARD_SIZE; ++v)
+                        array[v] = v + 1;
+                    shuffle(std::begin(array), std::end(array), generator);
+
+                    size_t rowStart = G::GRID_ROWS * start, colStart = G::GRID_COLS * start, counter = 0;
+                    for (size_t r = rowStart; r < rowStart + G::GRID_ROWS; ++r)
+                    {
+                        for (size_t c = colStart; c < colStart + G::GRID_COLS; ++c)
+                        {
+                            board[r][c] = array[counter++];
+                        }
+                    }
+                }
+
+                // find random solution, the caller checks the cancellation if the board is not solved
+                auto solution = solver.solveRandom(board, generator, MaxFailures);
+                if (solution)
+                    return *solution;
+                if (isCallCancelled())
+                    return board;
 
-            constraints[row][col] = 0;
+                SUDOKU_COUNT(BoardRestarts);
+            }
         }
+    }
 
-        return true;
+    template<class G>
+    typename G::Board generateGrid()
+    {
+        return generateGrid<G>(g_generator);
     }
 
-    RowCol GetRandomSpaceCell(const Board& board)
+    template<class G>
+    typename G::Board prepareRandomBoard(Generator& generator)
     {
-        std::uniform_int_distribution<size_t> rand(0, 9 - 1);
+        return generateGrid<G>(generator);
+    }
 
-        RowCol result(rand(g_mt), rand(g_mt));
-        while (board[result.row][result.col] != 0)
-            result = RowCol(rand(g_mt), rand(g_mt));
+    template<class G>
+    size_t countSolutions(const typename G::Board& board, size_t limit)
+    {
+        SUDOKU_COUNT(UniquenessChecks);
 
-        return result;
+        return getSolver<G>(getSolverBackend()).countSolutions(board, limit, nullptr);
     }
 
-    RowCol GetRandomNumberCell(const Board& board)
+    template<class G>
+    size_t getSolutions(typename G::Board& board, std::vector<typename G::Board>& solutions, size_t limit)
     {
-        std::uniform_int_distribution<size_t> rand(0, 9 - 1);
+        return getSolver<G>(getSolverBackend()).countSolutions(board, limit, &solutions);
+    }
 
-        RowCol result(rand(g_mt), rand(g_mt));
-        while (board[result.row][result.col] == 0)
-            result = RowCol(rand(g_mt), rand(g_mt));
+    template<class G>
+    std::optional<size_t> countSolutions(const typename G::Board& board, size_t limit, const Cancellation& cancellation)
+    {
+        CancellationScope scope(&cancellation);
+
+        size_t result = countSolutions<G>(board, limit);
+        if (isCallCancelled())
+            return {};
 
         return result;
     }
 
-    std::tuple<RowCol, RowCol> changeSpace(Board& board, const Board& solution)
+    template<class G>
+    std::optional<size_t> getSolutions(typename G::Board& board, std::vector<typename G::Board>& solutions, size_t limit, const Cancellation& cancellation)
     {
-        RowCol space = GetRandomSpaceCell(board);
-        RowCol number = GetRandomNumberCell(board);
-        Board constraints{};
+        CancellationScope scope(&cancellation);
 
-        board[space.row][space.col] = solution[space.row][space.col];
-        constraints[number.row][number.col] = board[number.row][number.col];
-        board[number.row][number.col] = 0;
+        size_t result = getSolutions<G>(board, solutions, limit);
+        if (isCallCancelled())
+            return {};
 
-        while (solveRandomBoard(board, &constraints))
-        {
-            board[number.row][number.col] = constraints[number.row][number.col];
-            constraints[number.row][number.col] = 0;
-            board[space.row][space.col] = 0;
+        return result;
+    }
 
-            space = GetRandomSpaceCell(board);
-            number = GetRandomNumberCell(board);
+    template<class G>
+    std::optional<typename G::Board> solveRandomBoard(const typename G::Board& board, const Cancellation& cancellation)
+    {
+        CancellationScope scope(&cancellation);
 
-            board[space.row][space.col] = solution[space.row][space.col];
-            constraints[number.row][number.col] = board[number.row][number.col];
-            board[number.row][number.col] = 0;
-        }
+        auto result = solveRandomBoard<G>(board);
+        if (isCallCancelled())
+            return {};
 
-        return { space, number };
+        return result;
     }
 
-    void changeRevert(RowCol space, RowCol number, Board& board, const Board& solution)
+    // all cells in random order, cells are tried to be turned into spaces in this order
+    // (drawn at once, so the generator is used the same way however the removal goes)
+    template<class G>
+    Cells<G> getSpaceCandidates(Generator& generator)
     {
-        board[number.row][number.col] = solution[number.row][number.col];
-        board[space.row][space.col] = 0;
+        Cells<G> result;
+
+        for (size_t cell = 0; cell < G::CELLS_COUNT; ++cell)
+            result[cell] = static_cast<typename G::Cell>(cell);
+        shuffle(result.begin(), result.end(), generator);
+
+        return result;
     }
 
-    std::tuple<Board, Board> generateSudoku(size_t spaces)
+    template<class G>
+    size_t computeDifficulty(const typename G::Board& solution, const typename G::Board& board)
     {
-        Board solution = prepareRandomBoard();
-        Board board = solution;
+        SUDOKU_TIME_PHASE(ComputeDifficulty);
 
-        while (!removeSpaces(board, spaces))
-        {
-            solution = prepareRandomBoard();
-            board = solution;
-        }
+        using Candidates = typename G::Candidates;
 
-        return { board, solution };
-    }
+        BoardScan<G> scan;
+        scanBoard(board, BoardMasks<G>(board), scan);
 
-    std::tuple<Board, Board> generateSudokuWithDifficulty(size_t spaces, size_t minDifficulty, size_t maxDifficulty)
-    {
-        static const uint32_t TotalNumberOfAttempts = 81;
+        auto& candidates = scan.candidates;
+        CellSet<G> emptyCells = scan.empty, singleCells = scan.singles;
 
-        auto [board, solution] = generateSudoku(spaces);
+        size_t singleCellCandidates = 0;
 
-        while (true)
+        while (!emptyCells.empty())
         {
-            size_t difficulty = computeDifficulty(solution, board);
+            size_t cell = 0;
 
-            if (difficulty >= minDifficulty && difficulty < maxDifficulty)
-                return { board, solution };
+            singleCellCandidates += singleCells.size();
 
-            uint32_t numberOfAttempts = 0;
-            while (numberOfAttempts < TotalNumberOfAttempts)
+            if (singleCells.empty())
+            {
+                size_t minCount = std::numeric_limits<size_t>::max();
+                emptyCells.forEach([&](size_t c)
+                {
+                    size_t count = countCandidates(candidates[c]);
+                    if (count < minCount)
+                    {
+                        cell = c;
+                        minCount = count;
+                    }
+                });
+            }
+            else
             {
-                auto[space, number] = changeSpace(board, solution);
+                cell = singleCells.first();
+            }
 
-                auto newDifficulty = computeDifficulty(solution, board);
+            emptyCells.erase(cell);
+            singleCells.erase(cell);
 
-                if (newDifficulty >= minDifficulty && newDifficulty < maxDifficulty)
-                    return { board, solution };
+            // only peers of the filled cell lose a candidate
+            Candidates bit = numberBit<Candidates>(solution[cell / G::BOARD_SIZE][cell % G::BOARD_SIZE]);
+            for (auto peer : g_peers<G>[cell])
+            {
+                if (!emptyCells.contains(peer) || !(candidates[peer] & bit))
+                    continue;
 
-                if ((difficulty < minDifficulty && newDifficulty < difficulty) || (difficulty > maxDifficulty && newDifficulty > difficulty))
-                    changeRevert(space, number, board, solution);
+                candidates[peer] &= ~bit;
+                if (countCandidates(candidates[peer]) == 1)
+                    singleCells.insert(peer);
                 else
-                    difficulty = newDifficulty;
-
-                numberOfAttempts++;
+                    singleCells.erase(peer);
             }
-
-            std::tie(board, solution) = generateSudoku(spaces);
         }
 
-        return { board, solution };
+        return singleCellCandidates;
     }
 
-    size_t countSpaces(const Board& board)
+    template<class G>
+    bool removeSpacesSequential(typename G::Board& board, size_t spaces, const Cells<G>& spaceCandidates)
     {
-        size_t res = 0;
+        size_t currentSpaces = 0, next = 0;
+        while (currentSpaces < spaces)
+        {
+            if (next == G::CELLS_COUNT)
+            {
+                // we are not able to create board with spaces
+                return false;
+            }
 
-        for (size_t r = 0; r < Sudoku::BOARD_SIZE; ++r)
-            for (size_t c = 0; c < Sudoku::BOARD_SIZE; ++c)
-                res += board[r][c] == 0 ? 1 : 0;
+            size_t cell = spaceCandidates[next++];
+            size_t row = cell / G::BOARD_SIZE, col = cell % G::BOARD_SIZE;
 
-        return res;
-    }
+            uint8_t number = board[row][col];
+            board[row][col] = 0;
 
-    BoardCandidates getBoardCandidates(const Board& board)
-    {
-        BoardCandidates result;
+            // if the board has more solutions now, we have introduced another one
+            size_t solutions = countSolutions<G>(board, 2);
+            if (isCallCancelled())
+                return false;
 
-        for (size_t r = 0; r < Sudoku::BOARD_SIZE; ++r)
-        {
-            for (size_t c = 0; c < Sudoku::BOARD_SIZE; ++c)
+            if (solutions != 1)
+            {
+                // revert back
+                board[row][col] = number;
+                SUDOKU_COUNT(RejectedRemovals);
+            }
+            else
             {
-                if (board[r][c] == 0)
-                    result[r][c] = getCandidatesArray(board, r, c);
+                currentSpaces++;
             }
         }
 
-        return result;
+        return true;
     }
 
-    std::optional<uint8_t> getSingleCandidate(const Candidates& candidates)
+    // threads which help removeSpaces of the calling thread, started by its first call with more threads
+    // and kept for the next calls (a new count of threads starts new ones), each round runs the task on
+    // the calling thread (id 0) and on all workers and returns when all of them finished it
+    struct RemovalWorkers
     {
-        std::optional<uint8_t> result;
-        for (uint8_t v = 0; v < candidates.size(); v++)
+        size_t threads;
+        std::barrier<> sync;
+        std::vector<std::thread> workers;
+
+        // written by the calling thread before the round starts
+        void (*task)(void* context, size_t id) = nullptr;
+        void* context = nullptr;
+        // workers are stopped by the cancellation of the calling thread
+        const Cancellation* cancellation = nullptr;
+        bool stopping = false;
+
+        explicit RemovalWorkers(size_t t) : threads(t), sync(static_cast<std::ptrdiff_t>(t))
         {
-            if (candidates[v])
+            for (size_t id = 1; id < threads; ++id)
             {
-                if (result)
-                    return {};
-                result = v;
+                workers.emplace_back([this, id]()
+                {
+                    while (true)
+                    {
+                        sync.arrive_and_wait();
+                        if (stopping)
+                            break;
+                        {
+                            CancellationScope scope(cancellation);
+                            task(context, id);
+                        }
+                        sync.arrive_and_wait();
+                    }
+                });
             }
         }
-        return result;
-    }
 
-    void updateBoardCandidatesArray(BoardCandidates& boardCandidates, size_t row, size_t col, uint8_t value)
-    {
-        for (size_t c = 0; c < BOARD_SIZE; c++)
-            boardCandidates[row][c][value] = false;
+        ~RemovalWorkers()
+        {
+            stopping = true;
+            sync.arrive_and_wait();
+            for (auto& worker : workers)
+                worker.join();
+        }
 
-        for (size_t r = 0; r < BOARD_SIZE; r++)
-            boardCandidates[r][col][value] = false;
+        template<class Task>
+        void run(Task& t)
+        {
+            task = [](void* c, size_t id) { (*static_cast<Task*>(c))(id); };
+            context = &t;
+            cancellation = g_cancellationState.cancellation;
+
+            sync.arrive_and_wait();
+            t(0);
+            sync.arrive_and_wait();
+        }
+    };
 
-        size_t rowStart = (row / GRID_COUNT) * GRID_COUNT;
-        size_t colStart = (col / GRID_COUNT) * GRID_COUNT;
-        for (size_t r = rowStart; r < rowStart + GRID_COUNT; ++r)
+    RemovalWorkers& getRemovalWorkers(size_t threads)
+    {
+        thread_local std::unique_ptr<RemovalWorkers> workers;
+        if (!workers || workers->threads != threads)
         {
-            for (size_t c = colStart; c < colStart + GRID_COUNT; ++c)
-                boardCandidates[r][c][value] = false;
+            workers.reset();
+            workers = std::make_unique<RemovalWorkers>(threads);
         }
+
+        return *workers;
     }
 
-    bool eliminateSingleCandidates(Board& board, size_t& spaces, BoardCandidates& boardCandidates)
+    // candidates of a round are tested concurrently against the same board, rejected candidates are dropped
+    // for good (more spaces can't make the solution unique again), the result is the same as of the sequential
+    // removal, rounds test candidates in one of two ways:
+    // - each one alone, the first accepted one is removed and other accepted ones are tested again in the next
+    //   round, best when most candidates are rejected
+    // - candidate i with all candidates before it removed too, all candidates before the first rejected one
+    //   are removed in one round, best when most candidates are accepted (early on)
+    template<class G>
+    bool removeSpacesSpeculative(typename G::Board& board, size_t spaces, Cells<G> spaceCandidates, size_t threads)
     {
-        bool somethingChanged = false;
+        using Board = typename G::Board;
 
-        while (spaces != 0)
+        // written by the calling thread before the round starts
+        Board snapshot;
+        Cells<G> round;
+        size_t roundSize = 0;
+        bool prefixes = true;
+        // written by workers, read after the round ends
+        std::array<bool, G::CELLS_COUNT> unique;
+
+        auto test = [&](size_t id)
         {
-            bool filled = false;
+            for (size_t i = id; i < roundSize; i += threads)
+            {
+                Board tmp = snapshot;
+                for (size_t j = prefixes ? 0 : i; j <= i; ++j)
+                    tmp[round[j] / G::BOARD_SIZE][round[j] % G::BOARD_SIZE] = 0;
+                unique[i] = countSolutions<G>(tmp, 2) == 1;
+            }
+        };
 
-            for (size_t r = 0; r < Sudoku::BOARD_SIZE; ++r)
+        auto& workers = getRemovalWorkers(threads);
+
+        // candidates before next were accepted or rejected
+        size_t currentSpaces = 0, next = 0;
+        while (currentSpaces < spaces)
+        {
+            if (next == G::CELLS_COUNT)
+                return false;
+
+            // removed prefixes must not get past spaces
+            roundSize = std::min(threads, G::CELLS_COUNT - next);
+            if (prefixes)
+                roundSize = std::min(roundSize, spaces - currentSpaces);
+            std::copy_n(spaceCandidates.begin() + next, roundSize, round.begin());
+            snapshot = board;
+
+            workers.run(test);
+
+            // results of the round are not reliable, cancelled counts return 0
+            if (isCallCancelled())
+                return false;
+
+            size_t first = 0, accepted = 0;
+            if (prefixes)
             {
-                for (size_t c = 0; c < Sudoku::BOARD_SIZE; ++c)
+                // candidates before the first failed prefix are accepted, it is rejected, the rest is tested again
+                while (first < roundSize && unique[first])
+                    first++;
+
+                for (size_t i = 0; i < first; ++i)
+                    board[round[i] / G::BOARD_SIZE][round[i] % G::BOARD_SIZE] = 0;
+                currentSpaces += first;
+                accepted = first;
+
+                if (first < roundSize)
+                    SUDOKU_COUNT(RejectedRemovals);
+                next += std::min(first + 1, roundSize);
+            }
+            else
+            {
+                while (first < roundSize && !unique[first])
+                    first++;
+                next += roundSize;
+
+                for (size_t i = 0; i < roundSize; ++i)
                 {
-                    if (board[r][c] != 0)
-                        continue;
+                    if (!unique[i])
+                        SUDOKU_COUNT(RejectedRemovals);
+                    else
+                        accepted++;
+                }
 
-                    if (auto singleCandidate = getSingleCandidate(boardCandidates[r][c]))
-                    {
-                        board[r][c] = *singleCandidate;
-                        updateBoardCandidatesArray(boardCandidates, r, c, board[r][c]);
-                        spaces--;
-                        somethingChanged = true;
+                if (first < roundSize)
+                {
+                    board[round[first] / G::BOARD_SIZE][round[first] % G::BOARD_SIZE] = 0;
+                    currentSpaces++;
 
-                        filled = true;
-                        break;
+                    // accepted ones were tested without the first one, they are tested again in their order
+                    for (size_t i = roundSize; i > first + 1; --i)
+                    {
+                        if (unique[i - 1])
+                            spaceCandidates[--next] = round[i - 1];
                     }
                 }
+            }
 
-                if (filled)
-                    break;
+            // the next round tests prefixes while most candidates pass
+            prefixes = 2 * accepted >= roundSize;
+        }
+
+        return true;
+    }
+
+    std::atomic<size_t> g_removalThreads = 1;
+
+    void setRemovalThreads(size_t threads)
+    {
+        g_removalThreads.store(threads, std::memory_order_relaxed);
+    }
+
+    size_t getRemovalThreads()
+    {
+        return g_removalThreads.load(std::memory_order_relaxed);
+    }
+
+    template<class G>
+    bool removeSpaces(typename G::Board& board, size_t spaces, Generator& generator, size_t threads)
+    {
+        SUDOKU_TIME_PHASE(RemoveSpaces);
+
+        auto spaceCandidates = getSpaceCandidates<G>(generator);
+
+        if (threads == 0)
+            threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        threads = std::min(threads, G::CELLS_COUNT);
+
+        if (threads == 1)
+            return removeSpacesSequential<G>(board, spaces, spaceCandidates);
+
+        return removeSpacesSpeculative<G>(board, spaces, spaceCandidates, threads);
+    }
+
+    template<class G>
+    bool removeSpaces(typename G::Board& board, size_t spaces, Generator& generator)
+    {
+        return removeSpaces<G>(board, spaces, generator, getRemovalThreads());
+    }
+
+    // puzzle whose numbers are removed one by one, masks and candidates of empty cells follow each removal,
+    // so the checks below don't scan the board again
+    template<class G>
+    struct ClueRemoval
+    {
+        using Board = typename G::Board;
+        using Candidates = typename G::Candidates;
+
+        Board& board;
+        BoardMasks<G> masks;
+        std::array<Candidates, G::CELLS_COUNT> candidates{};
+
+        ClueRemoval(Board& b) : board(b), masks(b)
+        {
+            for (size_t cell = 0; cell < G::CELLS_COUNT; ++cell)
+                if (board[cell / G::BOARD_SIZE][cell % G::BOARD_SIZE] == 0)
+                    candidates[cell] = masks.candidates(cell / G::BOARD_SIZE, cell % G::BOARD_SIZE);
+        }
+
+        // candidates of the cell and its empty peers after the cell changed
+        void update(size_t cell)
+        {
+            candidates[cell] = masks.candidates(cell / G::BOARD_SIZE, cell % G::BOARD_SIZE);
+            for (auto peer : g_peers<G>[cell])
+                if (board[peer / G::BOARD_SIZE][peer % G::BOARD_SIZE] == 0)
+                    candidates[peer] = masks.candidates(peer / G::BOARD_SIZE, peer % G::BOARD_SIZE);
+        }
+
+        void remove(size_t cell)
+        {
+            size_t row = cell / G::BOARD_SIZE, col = cell % G::BOARD_SIZE;
+            masks.clear(row, col, board[row][col]);
+            board[row][col] = 0;
+            update(cell);
+        }
+
+        void put(size_t cell, uint8_t number)
+        {
+            size_t row = cell / G::BOARD_SIZE, col = cell % G::BOARD_SIZE;
+            board[row][col] = number;
+            masks.set(row, col, number);
+            update(cell);
+        }
+
+        // true if the emptied cell can hold only the number, because it is its only candidate
+        // or because no other cell of its row, column or grid can hold the number
+        bool isForced(size_t cell, uint8_t number) const
+        {
+            Candidates bit = numberBit<Candidates>(number);
+            if (candidates[cell] == bit)
+                return true;
+
+            size_t row = cell / G::BOARD_SIZE, col = cell % G::BOARD_SIZE;
+            size_t gridRow = row / G::GRID_ROWS * G::GRID_ROWS, gridCol = col / G::GRID_COLS * G::GRID_COLS;
+            auto elsewhere = [&](size_t r, size_t c) { return (r != row || c != col) && board[r][c] == 0 && (candidates[r * G::BOARD_SIZE + c] & bit); };
+
+            bool inRow = false, inCol = false, inGrid = false;
+            for (size_t i = 0; i < G::BOARD_SIZE; ++i)
+            {
+                inRow = inRow || elsewhere(row, i);
+                inCol = inCol || elsewhere(i, col);
+                inGrid = inGrid || elsewhere(gridRow + i / G::GRID_COLS, gridCol + i % G::GRID_COLS);
             }
 
-            // if nothing was filled, there is no point to continue
-            if (!filled)
+            return !inRow || !inCol || !inGrid;
+        }
+
+        // true if the puzzle with the emptied cell has a solution with another number in the cell,
+        // the known solution is skipped, so a unique puzzle is proved by one exhausted search
+        // true also when the search gives up after maxFailures wrong guesses, the number then stays
+        bool hasOtherSolution(size_t cell, uint8_t number, size_t maxFailures) const
+        {
+            Board tmp = board;
+            SearchState<G> state(tmp, candidates);
+            state.candidates[cell] &= ~numberBit<Candidates>(number);
+            if (!state.candidates[cell])
+                return false;
+
+            size_t failures = maxFailures;
+            return solveRandomBoardRecursive(state, nullptr, failures) || failures == 0;
+        }
+    };
+
+    template<class G>
+    size_t removeSpacesMinimal(typename G::Board& board, Generator& generator)
+    {
+        SUDOKU_TIME_PHASE(RemoveSpaces);
+
+        // proving uniqueness of big puzzles with few numbers takes very long searches, the number stays
+        // when its search runs out of wrong guesses, so the result may be not minimal then
+        // (9x9 checks need far fewer, 16x16 puzzles take hundreds of milliseconds with this limit)
+        static const size_t MaxFailures = 8192;
+
+        auto spaceCandidates = getSpaceCandidates<G>(generator);
+        ClueRemoval<G> removal(board);
+
+        // a number which had to stay has to stay with fewer numbers too, so one pass is enough
+        size_t spaces = 0;
+        for (size_t cell : spaceCandidates)
+        {
+            uint8_t number = board[cell / G::BOARD_SIZE][cell % G::BOARD_SIZE];
+            if (number == 0)
+            {
+                spaces++;
+                continue;
+            }
+
+            removal.remove(cell);
+            if (removal.isForced(cell, number))
+            {
+                spaces++;
+                continue;
+            }
+
+            SUDOKU_COUNT(UniquenessChecks);
+            bool other = removal.hasOtherSolution(cell, number, MaxFailures);
+            if (isCallCancelled())
+            {
+                removal.put(cell, number);
                 break;
+            }
+
+            if (other)
+            {
+                removal.put(cell, number);
+                SUDOKU_COUNT(RejectedRemovals);
+            }
+            else
+            {
+                spaces++;
+            }
         }
 
-        return somethingChanged;
+        return spaces;
     }
 
-    std::array<RowCol, BOARD_SIZE> Grids
-    { 
-        RowCol{0, 0}, RowCol{0, 3}, RowCol{0, 6},
-        RowCol{3, 0}, RowCol{3, 3}, RowCol{3, 6},
-        RowCol{6, 0}, RowCol{6, 3}, RowCol{6, 6}
-    };
+    template<class G>
+    std::tuple<typename G::Board, typename G::Board> generateMinimalSudoku(size_t minSpaces, Generator& generator)
+    {
+        // minSpaces may be more than any grid reaches
+        static const size_t MaxAttempts = 100;
+
+        typename G::Board bestBoard{}, bestSolution{};
+        size_t bestSpaces = 0;
+
+        for (size_t attempt = 0; attempt < MaxAttempts; ++attempt)
+        {
+            auto solution = generateGrid<G>(generator);
+            auto board = solution;
 
-    bool eliminateCandidatesRowCol(Board& board, size_t& spaces, BoardCandidates& boardCandidates)
+            size_t spaces = removeSpacesMinimal<G>(board, generator);
+            if (spaces > bestSpaces || attempt == 0)
+            {
+                bestBoard = board;
+                bestSolution = solution;
+                bestSpaces = spaces;
+            }
+
+            if (spaces >= minSpaces || isCallCancelled())
+                break;
+
+            SUDOKU_COUNT(Regenerations);
+        }
+
+        return { bestBoard, bestSolution };
+    }
+
+    template<class G>
+    std::tuple<typename G::Board, typename G::Board> generateMinimalSudoku(size_t minSpaces)
+    {
+        return generateMinimalSudoku<G>(minSpaces, g_generator);
+    }
+
+    template<class G>
+    RowCol GetRandomSpaceCell(const typename G::Board& board, Generator& generator)
+    {
+        auto rand = [&generator]() { return random(generator, G::BOARD_SIZE); };
+
+        RowCol result(rand(), rand());
+        while (board[result.row][result.col] != 0)
+            result = RowCol(rand(), rand());
+
+        return result;
+    }
+
+    template<class G>
+    RowCol GetRandomNumberCell(const typename G::Board& board, Generator& generator)
+    {
+        auto rand = [&generator]() { return random(generator, G::BOARD_SIZE); };
+
+        RowCol result(rand(), rand());
+        while (board[result.row][result.col] == 0)
+            result = RowCol(rand(), rand());
+
+        return result;
+    }
+
+    template<class G>
+    std::tuple<RowCol, RowCol> changeSpace(typename G::Board& board, const typename G::Board& solution, Generator& generator)
+    {
+        SUDOKU_TIME_PHASE(ChangeSpace);
+
+        RowCol space = GetRandomSpaceCell<G>(board, generator);
+        RowCol number = GetRandomNumberCell<G>(board, generator);
+
+        board[space.row][space.col] = solution[space.row][space.col];
+        board[number.row][number.col] = 0;
+
+        while (countSolutions<G>(board, 2) != 1)
+        {
+            SUDOKU_COUNT(ChangeSpaceRetries);
+
+            board[number.row][number.col] = solution[number.row][number.col];
+            board[space.row][space.col] = 0;
+
+            // the board is left as it was before the change
+            if (isCallCancelled())
+                break;
+
+            space = GetRandomSpaceCell<G>(board, generator);
+            number = GetRandomNumberCell<G>(board, generator);
+
+            board[space.row][space.col] = solution[space.row][space.col];
+            board[number.row][number.col] = 0;
+        }
+
+        return { space, number };
+    }
+
+    template<class G>
+    void changeRevert(RowCol space, RowCol number, typename G::Board& board, const typename G::Board& solution)
+    {
+        board[number.row][number.col] = solution[number.row][number.col];
+        board[space.row][space.col] = 0;
+    }
+
+    template<class G>
+    std::tuple<typename G::Board, typename G::Board> generateSudoku(size_t spaces, Generator& generator)
+    {
+        auto solution = generateGrid<G>(generator);
+        auto board = solution;
+
+        while (!removeSpaces<G>(board, spaces, generator))
+        {
+            if (isCallCancelled())
+                break;
+
+            SUDOKU_COUNT(Regenerations);
+
+            solution = generateGrid<G>(generator);
+            board = solution;
+        }
+
+        return { board, solution };
+    }
+
+    template<class G>
+    std::tuple<typename G::Board, typename G::Board> generateSudoku(size_t spaces)
     {
-        bool somethingChanged = false;
+        return generateSudoku<G>(spaces, g_generator);
+    }
 
-        auto EliminateRow = [&boardCandidates, &somethingChanged](size_t grid, size_t row, uint8_t number)
+    template<class G>
+    std::tuple<typename G::Board, typename G::Board> generateSudokuWithDifficulty(size_t spaces, size_t minDifficulty, size_t maxDifficulty)
+    {
+        return generateSudokuWithDifficulty<G>(spaces, minDifficulty, maxDifficulty, g_generator);
+    }
+
+    // how far the difficulty is from the band, 0 inside of it
+    size_t getDifficultyDistance(size_t difficulty, size_t minDifficulty, size_t maxDifficulty)
+    {
+        if (difficulty < minDifficulty)
+            return minDifficulty - difficulty;
+        if (difficulty >= maxDifficulty)
+            return difficulty - maxDifficulty + 1;
+        return 0;
+    }
+
+    std::atomic<DifficultySearch> g_difficultySearch = DifficultySearch::Annealing;
+
+    void setDifficultySearch(DifficultySearch search)
+    {
+        g_difficultySearch.store(search, std::memory_order_relaxed);
+    }
+
+    DifficultySearch getDifficultySearch()
+    {
+        return g_difficultySearch.load(std::memory_order_relaxed);
+    }
+
+    // random changes of the puzzle, a change is reverted if it moves the difficulty away from the band
+    template<class G, class KeepClosest>
+    bool climbDifficulty(typename G::Board& board, const typename G::Board& solution, size_t minDifficulty, size_t maxDifficulty,
+        Generator& generator, KeepClosest& keepClosest)
+    {
+        static const uint32_t TotalNumberOfAttempts = G::CELLS_COUNT;
+
+        size_t difficulty = computeDifficulty<G>(solution, board);
+
+        if (difficulty >= minDifficulty && difficulty < maxDifficulty)
+            return true;
+
+        keepClosest(difficulty);
+
+        uint32_t numberOfAttempts = 0;
+        while (numberOfAttempts < TotalNumberOfAttempts)
         {
-            for (size_t c = Grids[grid].col; c < Grids[grid].col + GRID_COUNT; ++c)
+            SUDOKU_COUNT(HillClimbSteps);
+
+            auto[space, number] = changeSpace<G>(board, solution, generator);
+            if (isCallCancelled())
+                return false;
+
+            auto newDifficulty = computeDifficulty<G>(solution, board);
+
+            if (newDifficulty >= minDifficulty && newDifficulty < maxDifficulty)
+                return true;
+
+            keepClosest(newDifficulty);
+
+            if ((difficulty < minDifficulty && newDifficulty < difficulty) || (difficulty >= maxDifficulty && newDifficulty > difficulty))
+                changeRevert<G>(space, number, board, solution);
+            else
+                difficulty = newDifficulty;
+
+            numberOfAttempts++;
+        }
+
+        return false;
+    }
+
+    // swaps of a space and a number rated in each annealing step
+    static const size_t ANNEALING_SWAPS = 8;
+    // difficulty distance which is accepted with probability 1/e at the start
+    static const double ANNEALING_TEMPERATURE = 16.0;
+    static const double ANNEALING_COOLING = 0.97;
+    // annealing starts again with new spaces of the same solution before the solution is replaced
+    static const size_t ANNEALING_SOLUTION_RESTARTS = 4;
+
+    // rating of a swap doesn't need unique solution (numbers are taken from the solution), so the difficulty
+    // of several swaps is computed first and only the chosen one pays for the uniqueness check
+    // swaps are rated by the whole computeDifficulty, not by a change of candidates of peers of the two cells:
+    // difficulty sums naked singles of the whole fill, so one change moves it through all later steps,
+    // and the peer estimate correlates with the real change only 0.6 at 40 spaces and 0.15 to 0.3 at 50 to 55
+    template<class G, class KeepClosest>
+    bool annealDifficulty(typename G::Board& board, const typename G::Board& solution, size_t minDifficulty, size_t maxDifficulty,
+        Generator& generator, KeepClosest& keepClosest)
+    {
+        size_t difficulty = computeDifficulty<G>(solution, board);
+        size_t distance = getDifficultyDistance(difficulty, minDifficulty, maxDifficulty);
+        keepClosest(difficulty);
+
+        double temperature = ANNEALING_TEMPERATURE;
+        for (size_t step = 0; step < 2 * G::CELLS_COUNT && distance != 0; ++step, temperature *= ANNEALING_COOLING)
+        {
+            SUDOKU_COUNT(HillClimbSteps);
+
+            // rated swaps, closest to the band first
+            struct Swap
+            {
+                size_t distance;
+                size_t difficulty;
+                RowCol space, number;
+            };
+            std::array<Swap, ANNEALING_SWAPS> swaps;
+            for (auto& swap : swaps)
             {
-                if (boardCandidates[row][c][number])
+                swap.space = GetRandomSpaceCell<G>(board, generator);
+                swap.number = GetRandomNumberCell<G>(board, generator);
+
+                board[swap.space.row][swap.space.col] = solution[swap.space.row][swap.space.col];
+                board[swap.number.row][swap.number.col] = 0;
+                swap.difficulty = computeDifficulty<G>(solution, board);
+                swap.distance = getDifficultyDistance(swap.difficulty, minDifficulty, maxDifficulty);
+                changeRevert<G>(swap.space, swap.number, board, solution);
+            }
+            std::sort(swaps.begin(), swaps.end(), [](const Swap& a, const Swap& b) { return a.distance < b.distance; });
+
+            // the first one which keeps the solution unique is taken,
+            // a worse swap is taken with probability exp(-increase / temperature)
+            const Swap* taken = nullptr;
+            for (const auto& swap : swaps)
+            {
+                if (swap.distance > distance)
+                {
+                    static const size_t Resolution = 1 << 16;
+                    double probability = std::exp((static_cast<double>(distance) - static_cast<double>(swap.distance)) / temperature);
+                    if (random(generator, Resolution) >= probability * Resolution)
+                        break;
+                }
+
+                board[swap.space.row][swap.space.col] = solution[swap.space.row][swap.space.col];
+                board[swap.number.row][swap.number.col] = 0;
+
+                if (countSolutions<G>(board, 2) == 1)
                 {
-                    somethingChanged = true;
-                    boardCandidates[row][c][number] = false;
+                    taken = &swap;
+                    break;
                 }
+
+                SUDOKU_COUNT(ChangeSpaceRetries);
+                changeRevert<G>(swap.space, swap.number, board, solution);
+                if (isCallCancelled())
+                    return false;
+            }
+
+            if (!taken)
+                continue;
+
+            difficulty = taken->difficulty;
+            distance = taken->distance;
+            keepClosest(difficulty);
+        }
+
+        return distance == 0;
+    }
+
+    // if the call is cancelled, the puzzle closest to the band is returned (none if there is no puzzle yet)
+    template<class G>
+    std::optional<std::tuple<typename G::Board, typename G::Board>> generateSudokuClosestToDifficulty(size_t spaces, size_t minDifficulty, size_t maxDifficulty, Generator& generator)
+    {
+        std::optional<std::tuple<typename G::Board, typename G::Board>> best;
+        size_t bestDistance = std::numeric_limits<size_t>::max();
+
+        auto [board, solution] = generateSudoku<G>(spaces, generator);
+
+        // the puzzle is kept only when somebody can stop the call
+        auto keepClosest = [&](size_t difficulty)
+        {
+            size_t distance = getDifficultyDistance(difficulty, minDifficulty, maxDifficulty);
+            if (g_cancellationState.cancellation && distance < bestDistance)
+            {
+                bestDistance = distance;
+                best = std::tuple{ board, solution };
             }
         };
 
-        auto EliminateCol = [&boardCandidates, &somethingChanged](size_t grid, size_t col, uint8_t number)
+        bool annealing = getDifficultySearch() == DifficultySearch::Annealing;
+        size_t restarts = 0;
+
+        while (true)
         {
-            for (size_t r = Grids[grid].row; r < Grids[grid].row + GRID_COUNT; ++r)
+            if (isCallCancelled())
+                return best;
+
+            bool found = annealing
+                ? annealDifficulty<G>(board, solution, minDifficulty, maxDifficulty, generator, keepClosest)
+                : climbDifficulty<G>(board, solution, minDifficulty, maxDifficulty, generator, keepClosest);
+
+            if (found)
+                return std::tuple{ board, solution };
+            if (isCallCancelled())
+                return best;
+
+            SUDOKU_COUNT(HillClimbRestarts);
+
+            if (annealing && ++restarts % ANNEALING_SOLUTION_RESTARTS != 0)
             {
-                if (boardCandidates[r][col][number])
+                board = solution;
+                if (removeSpaces<G>(board, spaces, generator))
+                    continue;
+            }
+
+            std::tie(board, solution) = generateSudoku<G>(spaces, generator);
+        }
+    }
+
+    template<class G>
+    std::tuple<typename G::Board, typename G::Board> generateSudokuWithDifficulty(size_t spaces, size_t minDifficulty, size_t maxDifficulty, Generator& generator)
+    {
+        // without cancellation the search runs until a puzzle in the band is found
+        CancellationScope scope(nullptr);
+
+        return *generateSudokuClosestToDifficulty<G>(spaces, minDifficulty, maxDifficulty, generator);
+    }
+
+    template<class G>
+    std::optional<std::tuple<typename G::Board, typename G::Board>> generateSudoku(size_t spaces, Generator& generator, const Cancellation& cancellation)
+    {
+        CancellationScope scope(&cancellation);
+
+        auto result = generateSudoku<G>(spaces, generator);
+        if (isCallCancelled())
+            return {};
+
+        return result;
+    }
+
+    template<class G>
+    std::optional<std::tuple<typename G::Board, typename G::Board>> generateSudokuWithDifficulty(size_t spaces, size_t minDifficulty, size_t maxDifficulty,
+        Generator& generator, const Cancellation& cancellation)
+    {
+        CancellationScope scope(&cancellation);
+
+        return generateSudokuClosestToDifficulty<G>(spaces, minDifficulty, maxDifficulty, generator);
+    }
+
+    // state of the human style solver, placements and eliminations are propagated through work queues,
+    // so techniques run only on cells and grids whose candidates have changed
+    template<class G>
+    struct HumanSolver
+    {
+        using Board = typename G::Board;
+        using Candidates = typename G::Candidates;
+
+        Board board;
+        std::array<Candidates, G::CELLS_COUNT> candidates{};
+        size_t spaces = 0;
+
+        // cells which may have become naked single, each cell is queued at most once
+        Cells<G> singles;
+        size_t singlesCount = 0;
+        std::array<bool, G::CELLS_COUNT> queued{};
+
+        // grids in which some candidate was removed since they were checked
+        // (one bit per grid, candidates are wide enough for that)
+        Candidates dirtyGrids = 0;
+
+        HumanSolver(const Board& b) : board(b)
+        {
+            BoardScan<G> scan;
+            scanBoard(board, BoardMasks<G>(board), scan);
+
+            candidates = scan.candidates;
+            spaces = scan.empty.size();
+            scan.singles.forEach([this](size_t cell) { pushSingle(cell); });
+
+            dirtyGrids = static_cast<Candidates>((uint64_t(1) << G::BOARD_SIZE) - 1);
+        }
+
+        bool isEmpty(size_t cell) const
+        {
+            return board[cell / G::BOARD_SIZE][cell % G::BOARD_SIZE] == 0;
+        }
+
+        void pushSingle(size_t cell)
+        {
+            if (queued[cell])
+                return;
+
+            queued[cell] = true;
+            singles[singlesCount++] = static_cast<typename G::Cell>(cell);
+        }
+
+        // true if some candidate was removed
+        bool eliminate(size_t cell, Candidates numbers)
+        {
+            Candidates removed = candidates[cell] & numbers;
+            if (!removed)
+                return false;
+
+            candidates[cell] &= ~removed;
+            dirtyGrids |= static_cast<Candidates>(Candidates(1) << G::gridIndex(cell / G::BOARD_SIZE, cell % G::BOARD_SIZE));
+
+            if (countCandidates(candidates[cell]) == 1)
+                pushSingle(cell);
+
+            return true;
+        }
+
+        void place(size_t cell, uint8_t number)
+        {
+            board[cell / G::BOARD_SIZE][cell % G::BOARD_SIZE] = number;
+            candidates[cell] = 0;
+            spaces--;
+
+            for (auto peer : g_peers<G>[cell])
+                eliminate(peer, numberBit<Candidates>(number));
+        }
+
+        // fill queued naked singles (and the ones they create), true if some was filled
+        bool fillSingles()
+        {
+            bool filled = false;
+
+            while (singlesCount != 0)
+            {
+                size_t cell = singles[--singlesCount];
+                queued[cell] = false;
+
+                if (isEmpty(cell) && countCandidates(candidates[cell]) == 1)
                 {
-                    somethingChanged = true;
-                    boardCandidates[r][col][number] = false;
+                    place(cell, firstCandidate(candidates[cell]));
+                    filled = true;
                 }
             }
-        };
 
-        // iterate over grids
-        for (size_t g = 0; g < Grids.size(); g++)
+            return filled;
+        }
+
+        // if candidates for one number are in the grid only in single row / column,
+        // the number is removed from that row / column in other grids
+        bool eliminateRowCol(size_t grid)
         {
-            // in each grid check each number
-            for (uint8_t number = 1; number <= BOARD_SIZE; number++)
+            bool eliminated = false;
+
+            size_t rowStart = (grid / G::GRID_ROWS) * G::GRID_ROWS;
+            size_t colStart = (grid % G::GRID_ROWS) * G::GRID_COLS;
+
+            // candidates of each row / column within the grid
+            std::array<Candidates, G::GRID_ROWS> rows{};
+            std::array<Candidates, G::GRID_COLS> cols{};
+            for (size_t i = 0; i < G::GRID_ROWS; ++i)
+            {
+                for (size_t j = 0; j < G::GRID_COLS; ++j)
+                {
+                    Candidates cellCandidates = candidates[(rowStart + i) * G::BOARD_SIZE + colStart + j];
+                    rows[i] |= cellCandidates;
+                    cols[j] |= cellCandidates;
+                }
+            }
+
+            for (size_t i = 0; i < G::GRID_ROWS; ++i)
             {
-                // rows and cols in which this number is
-                std::set<size_t> rows, cols;
-                for (size_t r = Grids[g].row; r < Grids[g].row + GRID_COUNT; ++r)
+                Candidates onlyInRow = rows[i];
+                for (size_t k = 0; k < G::GRID_ROWS; ++k)
+                {
+                    if (k != i)
+                        onlyInRow &= ~rows[k];
+                }
+
+                for (size_t k = 0; onlyInRow && k < G::BOARD_SIZE; ++k)
                 {
-                    for (size_t c = Grids[g].col; c < Grids[g].col + GRID_COUNT; ++c)
+                    if (k < colStart || k >= colStart + G::GRID_COLS)
+                        eliminated |= eliminate((rowStart + i) * G::BOARD_SIZE + k, onlyInRow);
+                }
+            }
+
+            for (size_t i = 0; i < G::GRID_COLS; ++i)
+            {
+                Candidates onlyInCol = cols[i];
+                for (size_t k = 0; k < G::GRID_COLS; ++k)
+                {
+                    if (k != i)
+                        onlyInCol &= ~cols[k];
+                }
+
+                for (size_t k = 0; onlyInCol && k < G::BOARD_SIZE; ++k)
+                {
+                    if (k < rowStart || k >= rowStart + G::GRID_ROWS)
+                        eliminated |= eliminate(k * G::BOARD_SIZE + colStart + i, onlyInCol);
+                }
+            }
+
+            return eliminated;
+        }
+
+        // pointing pairs of grids changed since they were checked, until some helps
+        bool eliminateDirtyGrids()
+        {
+            while (dirtyGrids)
+            {
+                size_t grid = std::countr_zero(dirtyGrids);
+                dirtyGrids &= dirtyGrids - 1;
+
+                if (eliminateRowCol(grid))
+                    return true;
+            }
+
+            return false;
+        }
+
+        // rows, columns and grids
+        static const size_t UNITS_COUNT = 3 * G::BOARD_SIZE;
+
+        // cell i of the unit, cells of a grid are numbered row by row
+        static size_t unitCell(size_t unit, size_t i)
+        {
+            size_t n = unit % G::BOARD_SIZE;
+            switch (unit / G::BOARD_SIZE)
+            {
+            case 0:
+                return n * G::BOARD_SIZE + i;
+            case 1:
+                return i * G::BOARD_SIZE + n;
+            default:
+                return ((n / G::GRID_ROWS) * G::GRID_ROWS + i / G::GRID_COLS) * G::BOARD_SIZE + (n % G::GRID_ROWS) * G::GRID_COLS + i % G::GRID_COLS;
+            }
+        }
+
+        // calls function(subset) for each subset of size positions out of count
+        template<class Function>
+        static void forEachSubset(size_t count, size_t size, Function function)
+        {
+            std::array<size_t, 3> subset;
+            assert(size <= subset.size() && size <= count);
+
+            for (size_t i = 0; i < size; ++i)
+                subset[i] = i;
+
+            while (true)
+            {
+                function(subset);
+
+                size_t i = size;
+                while (i > 0 && subset[i - 1] == count - size + i - 1)
+                    --i;
+                if (i == 0)
+                    break;
+
+                subset[i - 1]++;
+                for (size_t j = i; j < size; ++j)
+                    subset[j] = subset[j - 1] + 1;
+            }
+        }
+
+        // numbers which are candidates only in one cell of a unit are placed there
+        bool fillHiddenSingles()
+        {
+            bool filled = false;
+
+            for (size_t unit = 0; unit < UNITS_COUNT; ++unit)
+            {
+                Candidates once = 0, twice = 0;
+                for (size_t i = 0; i < G::BOARD_SIZE; ++i)
+                {
+                    Candidates cellCandidates = candidates[unitCell(unit, i)];
+                    twice |= once & cellCandidates;
+                    once |= cellCandidates;
+                }
+
+                Candidates hidden = once & ~twice;
+                for (size_t i = 0; hidden && i < G::BOARD_SIZE; ++i)
+                {
+                    size_t cell = unitCell(unit, i);
+                    if (Candidates found = candidates[cell] & hidden)
                     {
-                        if (board[r][c] != 0)
-                            continue;
+                        place(cell, firstCandidate(found));
+                        filled = true;
+                    }
+                }
+            }
 
-                        if (boardCandidates[r][c][number])
-                        {
-                            rows.insert(r);
-                            cols.insert(c);
-                        }
+            return filled;
+        }
+
+        // if candidates for one number in a row / column are only in one grid,
+        // the number is removed from other cells of the grid
+        bool eliminateBoxLine()
+        {
+            bool eliminated = false;
+
+            for (size_t line = 0; line < 2 * G::BOARD_SIZE; ++line)
+            {
+                // candidates of the line in each grid it crosses
+                std::array<Candidates, G::BOARD_SIZE> grids{};
+                for (size_t i = 0; i < G::BOARD_SIZE; ++i)
+                {
+                    size_t cell = unitCell(line, i);
+                    grids[G::gridIndex(cell / G::BOARD_SIZE, cell % G::BOARD_SIZE)] |= candidates[cell];
+                }
+
+                Candidates once = 0, twice = 0;
+                for (auto gridCandidates : grids)
+                {
+                    twice |= once & gridCandidates;
+                    once |= gridCandidates;
+                }
+
+                for (size_t grid = 0; grid < G::BOARD_SIZE; ++grid)
+                {
+                    Candidates onlyInGrid = grids[grid] & once & ~twice;
+                    for (size_t i = 0; onlyInGrid && i < G::BOARD_SIZE; ++i)
+                    {
+                        size_t cell = unitCell(2 * G::BOARD_SIZE + grid, i);
+                        size_t position = line < G::BOARD_SIZE ? cell / G::BOARD_SIZE : cell % G::BOARD_SIZE;
+                        if (position != line % G::BOARD_SIZE)
+                            eliminated |= eliminate(cell, onlyInGrid);
                     }
                 }
-                // check the result
-                if (rows.size() == 1)
+            }
+
+            return eliminated;
+        }
+
+        // size cells of a unit with size candidates together, other cells of the unit lose them
+        bool eliminateNakedSubsets(size_t size)
+        {
+            bool eliminated = false;
+
+            for (size_t unit = 0; unit < UNITS_COUNT; ++unit)
+            {
+                // positions in the unit of cells which can be in the subset
+                std::array<size_t, G::BOARD_SIZE> positions;
+                size_t count = 0;
+                for (size_t i = 0; i < G::BOARD_SIZE; ++i)
+                {
+                    size_t candidatesCount = countCandidates(candidates[unitCell(unit, i)]);
+                    if (candidatesCount >= 2 && candidatesCount <= size)
+                        positions[count++] = i;
+                }
+
+                if (count < size)
+                    continue;
+
+                forEachSubset(count, size, [&](const std::array<size_t, 3>& subset)
                 {
-                    // iterate over grids in this row and remove candidates
-                    size_t firstGrid = (g / 3) * GRID_COUNT;
-                    for (size_t i = firstGrid; i < firstGrid + GRID_COUNT; i++)
+                    Candidates numbers = 0;
+                    uint32_t subsetPositions = 0;
+                    for (size_t k = 0; k < size; ++k)
+                    {
+                        numbers |= candidates[unitCell(unit, positions[subset[k]])];
+                        subsetPositions |= uint32_t(1) << positions[subset[k]];
+                    }
+
+                    if (countCandidates(numbers) != size)
+                        return;
+
+                    for (size_t i = 0; i < G::BOARD_SIZE; ++i)
                     {
-                        if (i != g)
-                            EliminateRow(i, *rows.begin(), number);
+                        if (!(subsetPositions & (uint32_t(1) << i)))
+                            eliminated |= eliminate(unitCell(unit, i), numbers);
                     }
+                });
+            }
+
+            return eliminated;
+        }
+
+        // size numbers which are candidates only in size cells of a unit, the cells lose other candidates
+        bool eliminateHiddenSubsets(size_t size)
+        {
+            bool eliminated = false;
+
+            for (size_t unit = 0; unit < UNITS_COUNT; ++unit)
+            {
+                // cells of each number in the unit, bit i is position i
+                std::array<uint32_t, G::NUMBERS_COUNT> cells{};
+                for (size_t i = 0; i < G::BOARD_SIZE; ++i)
+                {
+                    Candidates cellCandidates = candidates[unitCell(unit, i)];
+                    for (; cellCandidates; cellCandidates &= cellCandidates - 1)
+                        cells[firstCandidate(cellCandidates)] |= uint32_t(1) << i;
+                }
+
+                // numbers which can be in the subset
+                std::array<uint8_t, G::BOARD_SIZE> numbers;
+                size_t count = 0;
+                for (size_t number = 1; number < G::NUMBERS_COUNT; ++number)
+                {
+                    size_t cellsCount = std::popcount(cells[number]);
+                    if (cellsCount >= 2 && cellsCount <= size)
+                        numbers[count++] = static_cast<uint8_t>(number);
                 }
 
-                if (cols.size() == 1)
+                if (count < size)
+                    continue;
+
+                forEachSubset(count, size, [&](const std::array<size_t, 3>& subset)
                 {
-                    // iterate over grids in this column and remove candidates
-                    size_t firstGrid = g % 3;
-                    for (size_t i = firstGrid; i < BOARD_SIZE; i = i + 3)
+                    Candidates subsetNumbers = 0;
+                    uint32_t subsetCells = 0;
+                    for (size_t k = 0; k < size; ++k)
                     {
-                        if (i != g)
-                            EliminateCol(i, *cols.begin(), number);
+                        subsetNumbers |= numberBit<Candidates>(numbers[subset[k]]);
+                        subsetCells |= cells[numbers[subset[k]]];
+                    }
+
+                    if (static_cast<size_t>(std::popcount(subsetCells)) != size)
+                        return;
+
+                    for (; subsetCells; subsetCells &= subsetCells - 1)
+                        eliminated |= eliminate(unitCell(unit, std::countr_zero(subsetCells)), static_cast<Candidates>(~subsetNumbers));
+                });
+            }
+
+            return eliminated;
+        }
+
+        // a number has the same two candidate cells in two rows, so other rows lose it in these columns
+        // (the same for columns)
+        bool eliminateXWing()
+        {
+            bool eliminated = false;
+
+            for (size_t byCols = 0; byCols < 2; ++byCols)
+            {
+                for (size_t number = 1; number < G::NUMBERS_COUNT; ++number)
+                {
+                    Candidates bit = numberBit<Candidates>(static_cast<uint8_t>(number));
+
+                    // candidate positions of the number in each line
+                    std::array<uint32_t, G::BOARD_SIZE> lines{};
+                    for (size_t line = 0; line < G::BOARD_SIZE; ++line)
+                    {
+                        for (size_t i = 0; i < G::BOARD_SIZE; ++i)
+                        {
+                            if (candidates[unitCell(byCols * G::BOARD_SIZE + line, i)] & bit)
+                                lines[line] |= uint32_t(1) << i;
+                        }
+                    }
+
+                    for (size_t first = 0; first < G::BOARD_SIZE; ++first)
+                    {
+                        if (std::popcount(lines[first]) != 2)
+                            continue;
+
+                        for (size_t second = first + 1; second < G::BOARD_SIZE; ++second)
+                        {
+                            if (lines[second] != lines[first])
+                                continue;
+
+                            for (size_t line = 0; line < G::BOARD_SIZE; ++line)
+                            {
+                                if (line == first || line == second)
+                                    continue;
+
+                                for (uint32_t positions = lines[first]; positions; positions &= positions - 1)
+                                    eliminated |= eliminate(unitCell(byCols * G::BOARD_SIZE + line, std::countr_zero(positions)), bit);
+                            }
+                        }
                     }
                 }
             }
+
+            return eliminated;
+        }
+
+        // true if the technique placed a number or removed a candidate
+        bool apply(Technique technique)
+        {
+            switch (technique)
+            {
+            case Technique::NakedSingle:
+                return fillSingles();
+            case Technique::HiddenSingle:
+                return fillHiddenSingles();
+            case Technique::PointingPair:
+                return eliminateDirtyGrids();
+            case Technique::BoxLineReduction:
+                return eliminateBoxLine();
+            case Technique::NakedPair:
+                return eliminateNakedSubsets(2);
+            case Technique::XWing:
+                return eliminateXWing();
+            case Technique::HiddenPair:
+                return eliminateHiddenSubsets(2);
+            case Technique::NakedTriple:
+                return eliminateNakedSubsets(3);
+            case Technique::HiddenTriple:
+                return eliminateHiddenSubsets(3);
+            }
+
+            return false;
         }
+    };
+
+    static const char* TECHNIQUE_NAMES[TECHNIQUES_COUNT] =
+    {
+        "nakedSingle",
+        "hiddenSingle",
+        "pointingPair",
+        "boxLineReduction",
+        "nakedPair",
+        "xWing",
+        "hiddenPair",
+        "nakedTriple",
+        "hiddenTriple",
+    };
+
+    // ratings of the techniques similar to Sudoku Explainer
+    static const size_t TECHNIQUE_SCORES[TECHNIQUES_COUNT] = { 10, 15, 26, 28, 30, 32, 34, 36, 40 };
 
-        return somethingChanged;
+    const char* getTechniqueName(Technique technique)
+    {
+        return TECHNIQUE_NAMES[static_cast<size_t>(technique)];
+    }
+
+    size_t getTechniqueScore(Technique technique)
+    {
+        return TECHNIQUE_SCORES[static_cast<size_t>(technique)];
     }
 
-    bool solveSudoku(const Board& board, bool allowRowColElimination)
+    template<class G>
+    HumanSolution solveHuman(const typename G::Board& board, TechniqueSet techniques)
     {
-        size_t spaces = countSpaces(board);
-        Board workingBoard = board;
-        BoardCandidates boardCandidates = getBoardCandidates(board);
+        HumanSolver<G> solver(board);
+        HumanSolution result;
 
-        bool somethingChanged = false;
-        while (spaces != 0)
+        while (solver.spaces != 0)
         {
-            somethingChanged |= eliminateSingleCandidates(workingBoard, spaces, boardCandidates);
+            // after any progress, easier techniques are tried first again
+            size_t technique = 0;
+            while (technique < TECHNIQUES_COUNT &&
+                !((techniques & techniqueBit(Technique(technique))) && solver.apply(Technique(technique))))
+            {
+                technique++;
+            }
 
-            if (spaces == 0)
+            if (technique == TECHNIQUES_COUNT)
                 break;
 
-            if (allowRowColElimination)
-                somethingChanged |= eliminateCandidatesRowCol(workingBoard, spaces, boardCandidates);
-
-            if (!somethingChanged)
-                break;
-            somethingChanged = false;
+            result.used |= techniqueBit(Technique(technique));
+            result.score = std::max(result.score, TECHNIQUE_SCORES[technique]);
         }
 
-        return spaces == 0;
+        result.solved = solver.spaces == 0;
+        return result;
     }
+
+    template<class G>
+    bool solveSudoku(const typename G::Board& board, bool allowRowColElimination)
+    {
+        TechniqueSet techniques = techniqueBit(Technique::NakedSingle);
+        if (allowRowColElimination)
+            techniques |= techniqueBit(Technique::PointingPair);
+
+        return solveHuman<G>(board, techniques).solved;
+    }
+
+#define SUDOKU_INSTANTIATE(G) \
+    template void printBoard<G>(const G::Board& board); \
+    template BasicSolver<G>& getSolver<G>(SolverBackend backend); \
+    template std::vector<uint8_t> getCandidates<G>(const G::Board& board, size_t row, size_t column); \
+    template size_t countSolutions<G>(const G::Board& board, size_t limit); \
+    template size_t getSolutions<G>(G::Board& board, std::vector<G::Board>& solutions, size_t limit); \
+    template std::optional<G::Board> solveRandomBoard<G>(const G::Board& board); \
+    template std::optional<size_t> countSolutions<G>(const G::Board& board, size_t limit, const Cancellation& cancellation); \
+    template std::optional<size_t> getSolutions<G>(G::Board& board, std::vector<G::Board>& solutions, size_t limit, const Cancellation& cancellation); \
+    template std::optional<G::Board> solveRandomBoard<G>(const G::Board& board, const Cancellation& cancellation); \
+    template G::Board prepareRandomBoard<G>(Generator& generator); \
+    template G::Board generateGrid<G>(Generator& generator); \
+    template G::Board generateGrid<G>(); \
+    template bool removeSpaces<G>(G::Board& board, size_t spaces, Generator& generator); \
+    template bool removeSpaces<G>(G::Board& board, size_t spaces, Generator& generator, size_t threads); \
+    template size_t removeSpacesMinimal<G>(G::Board& board, Generator& generator); \
+    template std::tuple<G::Board, G::Board> generateMinimalSudoku<G>(size_t minSpaces); \
+    template std::tuple<G::Board, G::Board> generateMinimalSudoku<G>(size_t minSpaces, Generator& generator); \
+    template std::tuple<G::Board, G::Board> generateSudoku<G>(size_t spaces); \
+    template std::tuple<G::Board, G::Board> generateSudoku<G>(size_t spaces, Generator& generator); \
+    template std::tuple<G::Board, G::Board> generateSudokuWithDifficulty<G>(size_t spaces, size_t minDifficulty, size_t maxDifficulty); \
+    template std::tuple<G::Board, G::Board> generateSudokuWithDifficulty<G>(size_t spaces, size_t minDifficulty, size_t maxDifficulty, Generator& generator); \
+    template std::optional<std::tuple<G::Board, G::Board>> generateSudoku<G>(size_t spaces, Generator& generator, const Cancellation& cancellation); \
+    template std::optional<std::tuple<G::Board, G::Board>> generateSudokuWithDifficulty<G>(size_t spaces, size_t minDifficulty, size_t maxDifficulty, \
+        Generator& generator, const Cancellation& cancellation); \
+    template size_t computeDifficulty<G>(const G::Board& solution, const G::Board& board); \
+    template bool solveSudoku<G>(const G::Board& board, bool allowRowColElimination); \
+    template HumanSolution solveHuman<G>(const G::Board& board, TechniqueSet techniques);
+
+    SUDOKU_FOR_EACH_GEOMETRY(SUDOKU_INSTANTIATE)
+#undef SUDOKU_INSTANTIATE
 }
@@ -2,27 +2,279 @@
 #include <array>
 #include <vector>
 #include <optional>
+#include <tuple>
+#include <type_traits>
+#include <cstdint>
+#include <limits>
+#include <atomic>
+#include <chrono>
 
 namespace Sudoku
 {
-    static const size_t BOARD_SIZE = 9;
-    static const size_t GRID_COUNT = 3;
+    // board made of grids with GridRows x GridCols cells, it has GridRows * GridCols rows, columns,
+    // grids and numbers, so all sizes and widths of candidate masks are known at compile time
+    template<size_t GridRows, size_t GridCols>
+    struct Geometry
+    {
+        static constexpr size_t GRID_ROWS = GridRows;
+        static constexpr size_t GRID_COLS = GridCols;
+        static constexpr size_t BOARD_SIZE = GridRows * GridCols;
+        static constexpr size_t CELLS_COUNT = BOARD_SIZE * BOARD_SIZE;
+        static constexpr size_t NUMBERS_COUNT = BOARD_SIZE + 1; // +1 here because 0 is valid number (empty)
+        // cells sharing row, column or grid with a cell
+        static constexpr size_t PEERS_COUNT = 2 * (BOARD_SIZE - 1) + (GridRows - 1) * (GridCols - 1);
 
-    using Board = std::array<std::array<uint8_t, BOARD_SIZE>, BOARD_SIZE>;
-    using Candidates = std::array<bool, BOARD_SIZE + 1>;
+        static_assert(NUMBERS_COUNT <= 32, "candidates of a cell must fit into 32 bits");
+
+        using Board = std::array<std::array<uint8_t, BOARD_SIZE>, BOARD_SIZE>;
+        // bit n is set if number n is a candidate (bit 0 is unused)
+        using Candidates = std::conditional_t<(NUMBERS_COUNT <= 16), uint16_t, uint32_t>;
+        // index of a cell, row * BOARD_SIZE + col
+        using Cell = std::conditional_t<(CELLS_COUNT <= 256), uint8_t, uint16_t>;
+
+        static constexpr Candidates ALL_CANDIDATES = static_cast<Candidates>(((uint64_t(1) << NUMBERS_COUNT) - 1) & ~uint64_t(1));
+
+        // grids are numbered row by row
+        static constexpr size_t gridIndex(size_t row, size_t col)
+        {
+            return (row / GridRows) * GridRows + col / GridCols;
+        }
+    };
+
+    // supported geometries, templates below are instantiated only for them
+    using Geometry4 = Geometry<2, 2>;
+    using Geometry6 = Geometry<2, 3>;
+    using Geometry9 = Geometry<3, 3>;
+    using Geometry16 = Geometry<4, 4>;
+    using Geometry25 = Geometry<5, 5>;
+
+    // classic 9x9 board, used by functions when geometry is not given
+    static const size_t BOARD_SIZE = Geometry9::BOARD_SIZE;
+    static const size_t GRID_COUNT = Geometry9::GRID_ROWS;
+
+    using Board = Geometry9::Board;
+    using Candidates = Geometry9::Candidates;
     using BoardCandidates = std::array<std::array<Candidates, BOARD_SIZE>, BOARD_SIZE>;
 
-    void printBoard(const Board& board);
+    // random number generator (xoshiro256**) owned by the caller, the same seed always
+    // generates the same boards, instance must not be shared between threads
+    struct Generator
+    {
+        using result_type = uint64_t;
+
+        // seeded from std::random_device
+        Generator();
+        explicit Generator(uint64_t seed);
+
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+        result_type operator()();
+
+        uint64_t seed;
+        std::array<uint64_t, 4> state;
+    };
+
+    // stops calls which take it when cancel is called (from any thread) or when its deadline passes
+    // solvers check it every few hundreds of nodes, so calls return soon after that
+    struct Cancellation
+    {
+        using Clock = std::chrono::steady_clock;
+
+        std::atomic<bool> cancelled = false;
+        Clock::time_point deadline = Clock::time_point::max();
+
+        Cancellation() {}
+        explicit Cancellation(Clock::duration timeout) : deadline(Clock::now() + timeout) {}
+
+        void cancel()
+        {
+            cancelled.store(true, std::memory_order_relaxed);
+        }
+
+        bool isCancelled() const
+        {
+            return cancelled.load(std::memory_order_relaxed) || (deadline != Clock::time_point::max() && Clock::now() >= deadline);
+        }
+    };
+
+    template<class G = Geometry9>
+    void printBoard(const typename G::Board& board);
+
+    // solver backends, all of them find the same solutions (possibly in different order)
+    enum class SolverBackend
+    {
+        Backtracking, // bitmask candidates, cell with least candidates first
+        DancingLinks, // exact cover over 4 * CELLS_COUNT constraints (Knuth's algorithm X)
+    };
 
-    std::vector<uint8_t> getCandidates(const Board& board, size_t row, size_t column);
-    size_t getSolutions(Board& board, std::vector<Board>& solutions);
-    std::tuple<Board, Board> generateSudoku(size_t spaces);
-    std::tuple<Board, Board> generateSudokuWithDifficulty(size_t spaces, size_t minDifficulty, size_t maxDifficulty);
+    // common interface of solver backends
+    template<class G>
+    struct BasicSolver
+    {
+        using Board = typename G::Board;
+
+        virtual ~BasicSolver() = default;
+
+        // first solution found, none if the board has no solution
+        virtual std::optional<Board> solve(const Board& board) = 0;
+        // solution found when numbers are tried in random order, search gives up after maxFailures
+        // wrong guesses (the caller can try again, another random order may find solution much faster)
+        virtual std::optional<Board> solveRandom(const Board& board, Generator& generator, size_t maxFailures) = 0;
+        // number of solutions, search stops as soon as limit solutions is found
+        // found solutions are appended to solutions if it is not null
+        virtual size_t countSolutions(const Board& board, size_t limit, std::vector<Board>* solutions) = 0;
+    };
+
+    using Solver = BasicSolver<Geometry9>;
+
+    // solver of the backend owned by the calling thread
+    template<class G = Geometry9>
+    BasicSolver<G>& getSolver(SolverBackend backend);
+    // backend used by the functions below and by the generator, backtracking by default
+    void setSolverBackend(SolverBackend backend);
+    SolverBackend getSolverBackend();
+
+    template<class G = Geometry9>
+    std::vector<uint8_t> getCandidates(const typename G::Board& board, size_t row, size_t column);
+    // number of solutions of the board, search stops as soon as limit solutions is found
+    // (limit 2 is enough to check if the board has unique solution)
+    template<class G = Geometry9>
+    size_t countSolutions(const typename G::Board& board, size_t limit = 2);
+    // collects up to limit solutions of the board
+    template<class G = Geometry9>
+    size_t getSolutions(typename G::Board& board, std::vector<typename G::Board>& solutions, size_t limit = std::numeric_limits<size_t>::max());
+    // first solution found by the selected solver backend
+    template<class G = Geometry9>
+    std::optional<typename G::Board> solveRandomBoard(const typename G::Board& board);
+
+    // the same as above, but none is returned if the cancellation stops the call
+    // (solutions found until then are still appended to solutions)
+    template<class G = Geometry9>
+    std::optional<size_t> countSolutions(const typename G::Board& board, size_t limit, const Cancellation& cancellation);
+    template<class G = Geometry9>
+    std::optional<size_t> getSolutions(typename G::Board& board, std::vector<typename G::Board>& solutions, size_t limit, const Cancellation& cancellation);
+    // none also if the board has no solution, cancellation.isCancelled() tells which one happened
+    template<class G = Geometry9>
+    std::optional<typename G::Board> solveRandomBoard(const typename G::Board& board, const Cancellation& cancellation);
+
+    // random fully filled board (solution grid), boards up to 16x16 are filled cell by cell in row-major order
+    // with a random allowed number (bitmasks of rows, columns and grids), bigger ones by the random solver
+    // grids aren't exactly uniform, but a random arrangement (bands, rows, stacks, columns, transposition)
+    // and numbers make all transformations of a grid equally likely
+    template<class G = Geometry9>
+    typename G::Board generateGrid(Generator& generator);
+    // uses generator local to the calling thread
+    template<class G = Geometry9>
+    typename G::Board generateGrid();
+    // the same as generateGrid
+    template<class G = Geometry9>
+    typename G::Board prepareRandomBoard(Generator& generator);
+    // removes spaces numbers from the solved board keeping the solution unique
+    // returns false if it is not possible for this board
+    // with more threads several removals are tested at once, the result is the same for any count of threads
+    template<class G = Geometry9>
+    bool removeSpaces(typename G::Board& board, size_t spaces, Generator& generator);
+    template<class G = Geometry9>
+    bool removeSpaces(typename G::Board& board, size_t spaces, Generator& generator, size_t threads);
+    // removes numbers from the board until none can be removed without losing unique solution (minimal puzzle),
+    // each cell is tried once in random order, returns count of spaces (9x9 puzzles usually end with 55 to 59)
+    // a number whose check needs too long search stays, so big boards (16x16 and more) may end not quite minimal
+    template<class G = Geometry9>
+    size_t removeSpacesMinimal(typename G::Board& board, Generator& generator);
+    // threads used by removeSpaces when generating a single puzzle, 0 for all cores, workers are started by
+    // the first call of each calling thread and kept for its next calls
+    // 1 by default, more threads need several times fewer rounds of uniqueness checks (about 16 instead of 50
+    // on 4 threads for 9x9 with 50 spaces), but the latency win on real cores hasn't been measured yet
+    // (keep 1 when many puzzles are generated in parallel, e.g. by generateBatch)
+    void setRemovalThreads(size_t threads);
+    size_t getRemovalThreads();
+
+    // overloads without generator use generator local to the calling thread
+    template<class G = Geometry9>
+    std::tuple<typename G::Board, typename G::Board> generateSudoku(size_t spaces);
+    template<class G = Geometry9>
+    std::tuple<typename G::Board, typename G::Board> generateSudoku(size_t spaces, Generator& generator);
+    template<class G = Geometry9>
+    std::tuple<typename G::Board, typename G::Board> generateSudokuWithDifficulty(size_t spaces, size_t minDifficulty, size_t maxDifficulty);
+    template<class G = Geometry9>
+    std::tuple<typename G::Board, typename G::Board> generateSudokuWithDifficulty(size_t spaces, size_t minDifficulty, size_t maxDifficulty, Generator& generator);
+    // minimal puzzle with at least minSpaces spaces, new grids are tried until one has enough of them,
+    // after 100 grids or when the call is cancelled the one with most spaces is returned
+    // (count the spaces of the result, it may have fewer or more)
+    template<class G = Geometry9>
+    std::tuple<typename G::Board, typename G::Board> generateMinimalSudoku(size_t minSpaces);
+    template<class G = Geometry9>
+    std::tuple<typename G::Board, typename G::Board> generateMinimalSudoku(size_t minSpaces, Generator& generator);
+    // none if the cancellation stops the call before the puzzle is finished
+    template<class G = Geometry9>
+    std::optional<std::tuple<typename G::Board, typename G::Board>> generateSudoku(size_t spaces, Generator& generator, const Cancellation& cancellation);
+    // if the cancellation stops the call, the puzzle with difficulty closest to the band found so far is returned
+    // (its difficulty has to be checked), none only if no puzzle with spaces was finished
+    template<class G = Geometry9>
+    std::optional<std::tuple<typename G::Board, typename G::Board>> generateSudokuWithDifficulty(size_t spaces, size_t minDifficulty, size_t maxDifficulty,
+        Generator& generator, const Cancellation& cancellation);
+
+    // how generateSudokuWithDifficulty moves the puzzle towards the difficulty band
+    enum class DifficultySearch
+    {
+        HillClimb, // random swaps of a space and a number, each checked for uniqueness, a new board after CELLS_COUNT swaps
+        Annealing, // several swaps are rated before the uniqueness check of the best one, worse ones are accepted
+                   // while the temperature is high, the solution is kept when the search starts again
+    };
+    // annealing by default
+    void setDifficultySearch(DifficultySearch search);
+    DifficultySearch getDifficultySearch();
     // up to 90 is hard
     // more than 300 is easy
-    size_t computeDifficulty(const Board& solution, const Board& board);
+    // (on 9x9 boards, bigger boards have higher ratings)
+    template<class G = Geometry9>
+    size_t computeDifficulty(const typename G::Board& solution, const typename G::Board& board);
 
     // solve with simple single candidate method
     // if allowRowColElimination is true, candidates are eliminitated if in the grid candidates for one number are in single row / column
-    bool solveSudoku(const Board& board, bool allowRowColElimination);
+    template<class G = Geometry9>
+    bool solveSudoku(const typename G::Board& board, bool allowRowColElimination);
+
+    // techniques of the human style solver from the easiest one, the solver always uses the easiest one which helps
+    enum class Technique
+    {
+        NakedSingle, // cell with single candidate
+        HiddenSingle, // number which has single cell in a row, column or grid
+        PointingPair, // candidates of a number in a grid are in single row / column, so other grids lose them there
+        BoxLineReduction, // candidates of a number in a row / column are in single grid, so the rest of the grid loses them
+        NakedPair, // two cells of a unit with the same two candidates, other cells of the unit lose them
+        XWing, // a number has the same two candidate columns in two rows (or rows in two columns)
+        HiddenPair, // two numbers which have the same two cells in a unit, the cells lose other candidates
+        NakedTriple,
+        HiddenTriple,
+    };
+    static const size_t TECHNIQUES_COUNT = 9;
+
+    // bit 1 << technique is set for each technique in the set
+    using TechniqueSet = uint32_t;
+    static const TechniqueSet ALL_TECHNIQUES = (TechniqueSet(1) << TECHNIQUES_COUNT) - 1;
+
+    inline TechniqueSet techniqueBit(Technique technique)
+    {
+        return TechniqueSet(1) << static_cast<size_t>(technique);
+    }
+
+    // name used in output, e.g. hiddenSingle
+    const char* getTechniqueName(Technique technique);
+    // grows with the order of techniques, from 10 for naked single to 40 for hidden triple
+    size_t getTechniqueScore(Technique technique);
+
+    struct HumanSolution
+    {
+        // false if the techniques weren't enough
+        bool solved = false;
+        // techniques which placed a number or removed a candidate
+        TechniqueSet used = 0;
+        // score of the hardest technique used, 0 if none was used
+        size_t score = 0;
+    };
+
+    // solve with the given techniques only, solveSudoku is the same as NakedSingle with optional PointingPair
+    template<class G = Geometry9>
+    HumanSolution solveHuman(const typename G::Board& board, TechniqueSet techniques = ALL_TECHNIQUES);
 }
@@ -0,0 +1,349 @@
+#include "symmetry.h"
+#include "candidates.h"
+#include <set>
+#include <algorithm>
+#include <numeric>
+
+namespace Sudoku
+{
+    std::array<uint8_t, BOARD_SIZE> getRandomLinesOrder(Generator& generator)
+    {
+        std::array<uint8_t, GRID_COUNT> bands;
+        std::iota(bands.begin(), bands.end(), uint8_t(0));
+        shuffle(bands.begin(), bands.end(), generator);
+
+        std::array<uint8_t, BOARD_SIZE> result;
+        for (size_t band = 0; band < GRID_COUNT; ++band)
+        {
+            std::array<uint8_t, GRID_COUNT> lines;
+            std::iota(lines.begin(), lines.end(), uint8_t(0));
+            shuffle(lines.begin(), lines.end(), generator);
+
+            for (size_t i = 0; i < GRID_COUNT; ++i)
+                result[band * GRID_COUNT + i] = static_cast<uint8_t>(bands[band] * GRID_COUNT + lines[i]);
+        }
+
+        return result;
+    }
+
+    Transform getRandomTransform(Generator& generator)
+    {
+        Transform result;
+
+        for (uint8_t n = 0; n <= BOARD_SIZE; ++n)
+            result.numbers[n] = n;
+        shuffle(result.numbers.begin() + 1, result.numbers.end(), generator);
+
+        result.rows = getRandomLinesOrder(generator);
+        result.cols = getRandomLinesOrder(generator);
+        result.transpose = random(generator, 2) == 1;
+
+        return result;
+    }
+
+    Board transformBoard(const Board& board, const Transform& transform)
+    {
+        Board result;
+
+        for (size_t r = 0; r < BOARD_SIZE; ++r)
+        {
+            for (size_t c = 0; c < BOARD_SIZE; ++c)
+            {
+                size_t row = transform.rows[r], col = transform.cols[c];
+                result[r][c] = transform.numbers[transform.transpose ? board[col][row] : board[row][col]];
+            }
+        }
+
+        return result;
+    }
+
+    Transform invertTransform(const Transform& transform)
+    {
+        Transform result;
+
+        for (uint8_t n = 0; n <= BOARD_SIZE; ++n)
+            result.numbers[transform.numbers[n]] = n;
+
+        // line rows[r] of the source is line r of the result, transposition swaps rows and columns back
+        std::array<uint8_t, BOARD_SIZE> rows, cols;
+        for (uint8_t line = 0; line < BOARD_SIZE; ++line)
+        {
+            rows[transform.rows[line]] = line;
+            cols[transform.cols[line]] = line;
+        }
+        result.rows = transform.transpose ? cols : rows;
+        result.cols = transform.transpose ? rows : cols;
+        result.transpose = transform.transpose;
+
+        return result;
+    }
+
+    std::vector<PuzzleVariant> multiplyPuzzle(const Board& board, const Board& solution, size_t count, Generator& generator)
+    {
+        // a random transformation rarely gives a puzzle which was already found, unless the puzzle is very symmetric
+        return multiplyPuzzle(board, solution, count, 0, std::numeric_limits<size_t>::max(), 4 * count + 100, generator);
+    }
+
+    std::vector<PuzzleVariant> multiplyPuzzle(const Board& board, const Board& solution, size_t count,
+        size_t minDifficulty, size_t maxDifficulty, size_t maxAttempts, Generator& generator)
+    {
+        std::vector<PuzzleVariant> result;
+        std::set<Board> found;
+
+        for (size_t attempt = 0; attempt < maxAttempts && result.size() < count; ++attempt)
+        {
+            Transform transform = getRandomTransform(generator);
+
+            PuzzleVariant variant;
+            variant.board = transformBoard(board, transform);
+            variant.solution = transformBoard(solution, transform);
+            variant.difficulty = computeDifficulty(variant.solution, variant.board);
+
+            if (variant.difficulty < minDifficulty || variant.difficulty >= maxDifficulty)
+                continue;
+
+            if (found.insert(variant.board).second)
+                result.push_back(variant);
+        }
+
+        return result;
+    }
+
+    using LineCounts = std::array<uint8_t, BOARD_SIZE>;
+
+    // numbers in each row of the board
+    LineCounts countNumbers(const Board& board)
+    {
+        LineCounts result{};
+        for (size_t r = 0; r < BOARD_SIZE; ++r)
+            for (size_t c = 0; c < BOARD_SIZE; ++c)
+                result[r] += board[r][c] != 0;
+
+        return result;
+    }
+
+    // least sequence of counts which can be reached by permuting lines, lines of each band
+    // are sorted and then bands are sorted
+    LineCounts getLeastCounts(const LineCounts& counts)
+    {
+        std::array<std::array<uint8_t, GRID_COUNT>, GRID_COUNT> bands;
+        for (size_t band = 0; band < GRID_COUNT; ++band)
+        {
+            std::copy_n(counts.begin() + band * GRID_COUNT, GRID_COUNT, bands[band].begin());
+            std::sort(bands[band].begin(), bands[band].end());
+        }
+        std::sort(bands.begin(), bands.end());
+
+        LineCounts result;
+        for (size_t line = 0; line < BOARD_SIZE; ++line)
+            result[line] = bands[line / GRID_COUNT][line % GRID_COUNT];
+
+        return result;
+    }
+
+    // finds the least transformation of the board, boards are ordered by numbers in rows, then by numbers
+    // in columns (both are cheap to minimize and leave only few arrangements) and then cell by cell in
+    // column-major order, the first column is chosen first, then rows one by one (bands stay together),
+    // then the other columns one by one (stacks stay together), each choice is compared with the best board
+    // found so far, so most of them are dropped early
+    struct CanonicalSearch
+    {
+        // board (or transposed board) and its rows and columns in the arranged order
+        const Board* source = nullptr;
+        bool transpose = false;
+        std::array<uint8_t, BOARD_SIZE> rows;
+        std::array<uint8_t, BOARD_SIZE> columns;
+        size_t firstColumn = 0;
+        // numbers in rows and columns of the source and their least arrangements
+        LineCounts rowCounts;
+        LineCounts colCounts;
+        LineCounts leastRowCounts;
+        LineCounts leastColCounts;
+        // columns of the best board and of the current one
+        Board best;
+        Board current;
+        bool found = false;
+        // incremented when the best board changes
+        size_t updates = 0;
+        // turns the board into the best board
+        Transform transform;
+
+        void searchRows(size_t row, uint32_t usedRows, size_t band, std::array<uint8_t, BOARD_SIZE + 1> labels, uint8_t nextLabel, bool less)
+        {
+            if (row == BOARD_SIZE)
+            {
+                columns[0] = static_cast<uint8_t>(firstColumn);
+                search(1, uint32_t(1) << firstColumn, firstColumn / GRID_COUNT, labels, nextLabel, less);
+                return;
+            }
+
+            for (size_t candidate = 0; candidate < BOARD_SIZE; ++candidate)
+            {
+                // the first row of a band can be from any unused band, the others from the same band
+                if ((usedRows >> candidate) & 1)
+                    continue;
+                if (row % GRID_COUNT != 0 && candidate / GRID_COUNT != band)
+                    continue;
+                if (rowCounts[candidate] != leastRowCounts[row])
+                    continue;
+
+                auto candidateLabels = labels;
+                uint8_t candidateNextLabel = nextLabel;
+
+                uint8_t number = (*source)[candidate][firstColumn];
+                if (number != 0 && candidateLabels[number] == 0)
+                    candidateLabels[number] = candidateNextLabel++;
+
+                current[0][row] = candidateLabels[number];
+                rows[row] = static_cast<uint8_t>(candidate);
+
+                int order = less ? -1 : 0;
+                if (order == 0 && found && current[0][row] != best[0][row])
+                    order = current[0][row] < best[0][row] ? -1 : 1;
+
+                if (order > 0)
+                    continue;
+
+                size_t updatesBefore = updates;
+                searchRows(row + 1, usedRows | (uint32_t(1) << candidate), candidate / GRID_COUNT, candidateLabels, candidateNextLabel, order < 0);
+
+                if (updates != updatesBefore)
+                    less = false;
+            }
+        }
+
+        void search(size_t column, uint32_t usedColumns, size_t stack, std::array<uint8_t, BOARD_SIZE + 1> labels, uint8_t nextLabel, bool less)
+        {
+            if (column == BOARD_SIZE)
+            {
+                best = current;
+                found = true;
+                updates++;
+
+                // numbers which are not on the board get the remaining labels
+                for (uint8_t n = 1; n <= BOARD_SIZE; ++n)
+                    transform.numbers[n] = labels[n] ? labels[n] : nextLabel++;
+                transform.numbers[0] = 0;
+                transform.rows = rows;
+                transform.cols = columns;
+                transform.transpose = transpose;
+                return;
+            }
+
+            for (size_t candidate = 0; candidate < BOARD_SIZE; ++candidate)
+            {
+                // the first column of a stack can be from any unused stack, the others from the same stack
+                if ((usedColumns >> candidate) & 1)
+                    continue;
+                if (column % GRID_COUNT != 0 && candidate / GRID_COUNT != stack)
+                    continue;
+                if (colCounts[candidate] != leastColCounts[column])
+                    continue;
+
+                auto candidateLabels = labels;
+                uint8_t candidateNextLabel = nextLabel;
+                int order = less ? -1 : 0;
+
+                for (size_t r = 0; r < BOARD_SIZE && order <= 0; ++r)
+                {
+                    uint8_t number = (*source)[rows[r]][candidate];
+                    if (number != 0 && candidateLabels[number] == 0)
+                        candidateLabels[number] = candidateNextLabel++;
+
+                    current[column][r] = candidateLabels[number];
+
+                    if (order == 0 && found && current[column][r] != best[column][r])
+                        order = current[column][r] < best[column][r] ? -1 : 1;
+                }
+
+                if (order > 0)
+                    continue;
+
+                columns[column] = static_cast<uint8_t>(candidate);
+
+                size_t updatesBefore = updates;
+                search(column + 1, usedColumns | (uint32_t(1) << candidate), candidate / GRID_COUNT, candidateLabels, candidateNextLabel, order < 0);
+
+                // the best board has the current columns now, later candidates must not be greater
+                if (updates != updatesBefore)
+                    less = false;
+            }
+        }
+    };
+
+    Board getCanonicalForm(const Board& board)
+    {
+        Transform transform;
+        return getCanonicalForm(board, transform);
+    }
+
+    Board getCanonicalForm(const Board& board, Transform& transform)
+    {
+        Board transposed;
+        for (size_t r = 0; r < BOARD_SIZE; ++r)
+            for (size_t c = 0; c < BOARD_SIZE; ++c)
+                transposed[r][c] = board[c][r];
+
+        CanonicalSearch search;
+
+        // transposition swaps counts of rows and columns
+        LineCounts rowCounts = countNumbers(board), colCounts = countNumbers(transposed);
+        auto leastRowCounts = getLeastCounts(rowCounts), leastColCounts = getLeastCounts(colCounts);
+        bool searchBoard = std::tie(leastRowCounts, leastColCounts) <= std::tie(leastColCounts, leastRowCounts);
+        bool searchTransposed = std::tie(leastColCounts, leastRowCounts) <= std::tie(leastRowCounts, leastColCounts);
+
+        for (bool transpose : { false, true })
+        {
+            if (!(transpose ? searchTransposed : searchBoard))
+                continue;
+
+            search.source = transpose ? &transposed : &board;
+            search.transpose = transpose;
+            search.rowCounts = transpose ? colCounts : rowCounts;
+            search.colCounts = transpose ? rowCounts : colCounts;
+            search.leastRowCounts = transpose ? leastColCounts : leastRowCounts;
+            search.leastColCounts = transpose ? leastRowCounts : leastColCounts;
+
+            for (size_t column = 0; column < BOARD_SIZE; ++column)
+            {
+                if (search.colCounts[column] != search.leastColCounts[0])
+                    continue;
+
+                search.firstColumn = column;
+
+                std::array<uint8_t, BOARD_SIZE + 1> labels{};
+                search.searchRows(0, 0, 0, labels, 1, false);
+            }
+        }
+
+        // columns were stored as rows
+        Board result;
+        for (size_t r = 0; r < BOARD_SIZE; ++r)
+            for (size_t c = 0; c < BOARD_SIZE; ++c)
+                result[r][c] = search.best[c][r];
+
+        transform = search.transform;
+        return result;
+    }
+
+    uint64_t hashBoard(const Board& board)
+    {
+        // FNV-1a
+        uint64_t result = 0xcbf29ce484222325;
+        for (const auto& row : board)
+        {
+            for (auto number : row)
+            {
+                result ^= number;
+                result *= 0x100000001b3;
+            }
+        }
+
+        return result;
+    }
+
+    uint64_t hashCanonicalForm(const Board& board)
+    {
+        return hashBoard(getCanonicalForm(board));
+    }
+}
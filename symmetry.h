@@ -0,0 +1,55 @@
+#pragma once
+#include "sudoku.h"
+
+// symmetries of classic 9x9 boards only (Board, BOARD_SIZE and GRID_COUNT), other geometries aren't supported
+// (Transform, multiplyPuzzle, getCanonicalForm and the validation cache built on them take the 9x9 Board)
+
+namespace Sudoku
+{
+    // transformation which keeps a valid board valid and a unique solution unique
+    // rows (and columns) can be permuted only within their band (stack) and bands (stacks) can be swapped
+    // there are 9! * 2 * 6^8 (about 1.2e12) of them
+    struct Transform
+    {
+        // numbers[n] replaces number n, numbers[0] is 0 so spaces stay spaces
+        std::array<uint8_t, BOARD_SIZE + 1> numbers;
+        // row r of the result is row rows[r] of the source (after transposition), the same for columns
+        std::array<uint8_t, BOARD_SIZE> rows;
+        std::array<uint8_t, BOARD_SIZE> cols;
+        bool transpose = false;
+    };
+
+    // each transformation has the same probability
+    Transform getRandomTransform(Generator& generator);
+    Board transformBoard(const Board& board, const Transform& transform);
+    // transformation which turns the transformed board back
+    Transform invertTransform(const Transform& transform);
+
+    struct PuzzleVariant
+    {
+        Board board;
+        Board solution;
+        size_t difficulty = 0;
+    };
+
+    // up to count different puzzles which are transformations of the puzzle, fewer are returned only
+    // if the puzzle has so many symmetries that there are not enough of them
+    std::vector<PuzzleVariant> multiplyPuzzle(const Board& board, const Board& solution, size_t count, Generator& generator);
+    // only variants with difficulty in [minDifficulty, maxDifficulty), at most maxAttempts transformations are tried
+    // (computeDifficulty prefers cells in row-major order, so variants usually have different difficulty,
+    // but checking one is still much cheaper than generating a new puzzle)
+    std::vector<PuzzleVariant> multiplyPuzzle(const Board& board, const Board& solution, size_t count,
+        size_t minDifficulty, size_t maxDifficulty, size_t maxAttempts, Generator& generator);
+
+    // the same board for all transformations of the board (spaces are kept), the least transformation
+    // when ordered by numbers in rows, numbers in columns and then cells in column-major order
+    // (numbers are relabeled in order of appearance), takes microseconds for puzzles, but milliseconds
+    // for full boards as counts of numbers don't tell their rows and columns apart
+    Board getCanonicalForm(const Board& board);
+    // transform turns the board into the canonical form (e.g. to move its solution there and back)
+    Board getCanonicalForm(const Board& board, Transform& transform);
+
+    uint64_t hashBoard(const Board& board);
+    // the same hash for all transformations of the board, used to find duplicates
+    uint64_t hashCanonicalForm(const Board& board);
+}
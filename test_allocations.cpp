@@ -0,0 +1,84 @@
+#include "sudoku.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+#include <iostream>
+
+// generation must not allocate once its buffers local to the thread are created, ctest runs this
+// and fails when a change brings a heap allocation back to the hot path (bench reports the same per benchmark)
+
+static std::atomic<int64_t> g_allocations{ 0 };
+
+// all replaceable forms go through these two, they are not inlined for the same reason as in bench.cpp
+[[gnu::noinline]] static void* allocate(size_t size, size_t alignment)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+
+    alignment = std::max(alignment, alignof(std::max_align_t));
+    size = (std::max<size_t>(size, 1) + alignment - 1) / alignment * alignment;
+    if (void* result = std::aligned_alloc(alignment, size))
+        return result;
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] static void deallocate(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void* operator new(size_t size) { return allocate(size, 0); }
+void* operator new[](size_t size) { return allocate(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment) { return allocate(size, size_t(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment) { return allocate(size, size_t(alignment)); }
+
+void operator delete(void* pointer) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, size_t) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { deallocate(pointer); }
+
+static const uint64_t SEED = 1;
+static const size_t PUZZLES_COUNT = 20;
+
+// the first call creates the buffers, the next ones must not allocate
+template<class Generate>
+static bool checkNoAllocations(const char* name, Generate generate)
+{
+    generate();
+
+    int64_t start = g_allocations.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < PUZZLES_COUNT; ++i)
+        generate();
+    int64_t allocations = g_allocations.load(std::memory_order_relaxed) - start;
+
+    std::cout << name << ": " << allocations << " allocations in " << PUZZLES_COUNT << " puzzles\n";
+    return allocations == 0;
+}
+
+int main()
+{
+    Sudoku::Generator generator(SEED);
+    bool passed = true;
+
+    passed &= checkNoAllocations("generateSudoku", [&]()
+    {
+        return Sudoku::generateSudoku(50, generator);
+    });
+
+    for (auto search : { Sudoku::DifficultySearch::HillClimb, Sudoku::DifficultySearch::Annealing })
+    {
+        Sudoku::setDifficultySearch(search);
+        passed &= checkNoAllocations(search == Sudoku::DifficultySearch::HillClimb ? "generateSudokuWithDifficulty (hill climb)"
+            : "generateSudokuWithDifficulty (annealing)", [&]()
+        {
+            return Sudoku::generateSudokuWithDifficulty(50, 100, 150, generator);
+        });
+    }
+
+    return passed ? 0 : 1;
+}